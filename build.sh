@@ -7,12 +7,20 @@ location=$(dirname "$script")
 
 # Common flags
 warnings="-Wall -Wextra -Wshadow -Wconversion -Wdouble-promotion -Wno-unused-function"
+# add -D WM_ARENA_STATS=1 to get arena usage dumped on exit,
+# -D WM_RENDER_STATS=1 for draw and bind counts, -D WM_PACING_STATS=1 for frame times
 common="-O0 -g -D NISK_DEBUG=1 -lm"
+# wm_math.h SIMD path: -mavx for AVX, -D WM_MATH_NO_SIMD for the scalar reference
+simd="-msse2"
 inc_dir="$location/external/include"
 lib_dir="$location/external/lib/linux"
 
 # Source files to compile
 platform_src="$location/code/wm_linux_main.c"
+bench_src="$location/code/wm_bench.c"
+math_check_src="$location/code/wm_math_check.c"
+helpers_check_src="$location/code/wm_helpers_check.c"
+packer_src="$location/code/wm_asset_packer.c"
 glad_src="$location/external/src/glad/glad.c"
 sources="$platform_src $glad_src"
 
@@ -20,9 +28,24 @@ sources="$platform_src $glad_src"
 sdl_lib="$lib_dir/SDL2"
 sdl_flags="-D _REENTRANT -lSDL2 -Wl,-rpath,$ORIGIN$sdl_lib"
 
-external_flags="-I$inc_dir $sdl_flags -lGL -ldl"
+external_flags="-I$inc_dir $sdl_flags -lGL -ldl -pthread"
 
 mkdir -p build
 cd build
 
-gcc $sources -o white-mage.out $common $warnings $external_flags 
+gcc $sources -o white-mage.out $common $simd $warnings $external_flags 
+
+# SIMD vs scalar math check, exits with 1 on a mismatch
+gcc $math_check_src -o white-mage-math-check.out -O2 -g -lm $simd $warnings -I$inc_dir
+./white-mage-math-check.out
+
+# MemoryPool handle checks, exits with 1 on a failure
+gcc $helpers_check_src -o white-mage-helpers-check.out -O2 -g -lm $simd $warnings -I$inc_dir
+./white-mage-helpers-check.out
+
+# Headless benchmarks, optimized since timing -O0 code tells us nothing
+gcc $bench_src -o white-mage-bench.out -O2 -g -lm $simd $warnings -I$inc_dir
+
+# Offline asset packer, the game picks up the pack from its working directory
+gcc $packer_src -o white-mage-packer.out -O2 -g -lm -pthread $simd $warnings -I$inc_dir
+./white-mage-packer.out "$location" white-mage.pack
@@ -1,7 +1,9 @@
 #version 420 core
 out vec4 FragColor;
 
+in vec4 LightColor;
+
 void main()
 {
-	FragColor = vec4(1.0);
+	FragColor = LightColor;
 }
\ No newline at end of file
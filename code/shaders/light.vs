@@ -1,11 +1,22 @@
 #version 420 core
 layout (location = 0) in vec3 aPos;
+layout (location = 2) in mat4 aModelViewProjection;
+layout (location = 13) in vec4 aColor;
+out vec4 LightColor;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameConstants
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	vec4 lightPos;
+	vec4 viewLightPos;
+	vec4 lightColor;
+	float time;
+};
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = aModelViewProjection * vec4(aPos, 1.0);
+	LightColor = aColor;
 }
\ No newline at end of file
@@ -1,20 +1,29 @@
 #version 420 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+layout (location = 2) in mat4 aModelViewProjection;
+layout (location = 6) in mat4 aModelView;
+layout (location = 10) in mat3 aNormalMatrix;
+layout (location = 13) in vec4 aColor;
 out vec3 FragPos;
 out vec3 Normal;
-out vec3 LightPos;
+out vec4 ObjectColor;
 
-uniform vec3 lightPos;
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 lightPos;
+    vec4 viewLightPos;
+    vec4 lightColor;
+    float time;
+};
 
 void main()
 {
-    gl_Position = projection * view * vec4(aPos, 1.0);
-    FragPos = vec3(view * model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(view * model))) * aNormal;
-    LightPos = vec3(view * vec4(lightPos, 1.0));
+    gl_Position = aModelViewProjection * vec4(aPos, 1.0);
+    FragPos = vec3(aModelView * vec4(aPos, 1.0));
+    Normal = aNormalMatrix * aNormal;
+    ObjectColor = aColor;
 }
\ No newline at end of file
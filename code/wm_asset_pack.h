@@ -0,0 +1,167 @@
+/* date = October 16th 2026 10:12 am */
+
+#ifndef WM_ASSET_PACK_H
+#define WM_ASSET_PACK_H
+
+// NOTE(sokus): Layout of the asset pack baked by wm_asset_packer.c, shared
+// by the packer and the game. The file is a header, then the entry table
+// sorted by name hash, then the entry data, every blob 16 byte aligned.
+// Everything is little-endian and meant to be used straight from a mapping.
+
+#define ASSET_PACK_MAGIC 0x4B41504Du // "MPAK"
+#define ASSET_PACK_VERSION 2
+#define ASSET_PACK_ALIGNMENT 16
+#define ASSET_PACK_FILE_NAME "white-mage.pack"
+
+typedef enum AssetPackEntryType
+{
+    AssetPackEntry_Raw,       // file bytes as they were on disk
+    AssetPackEntry_TileImage, // AssetPackImage followed by the tiles
+} AssetPackEntryType;
+
+typedef struct AssetPackHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t reserved;
+    uint64_t entries_offset;
+    uint64_t total_size;
+} AssetPackHeader;
+
+typedef struct AssetPackEntry
+{
+    uint64_t name_hash;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t type;
+    uint32_t reserved;
+} AssetPackEntry;
+
+typedef enum AssetPackImageFormat
+{
+    AssetPackImage_Raw, // channels bytes per pixel
+    AssetPackImage_BC7, // 16 byte blocks of 4x4 pixels, always RGBA
+} AssetPackImageFormat;
+
+// NOTE(sokus): Tiles are already in upload order, one layer per tile with
+// rows flipped for GL. The data is stored level by level starting at the
+// full size, each level holding all the layers, so every level goes up in a
+// single call.
+typedef struct AssetPackImage
+{
+    uint32_t tile_width;
+    uint32_t tile_height;
+    uint32_t tile_count_x;
+    uint32_t tile_count_y;
+    uint32_t channels; // of the source image
+    uint32_t format;   // AssetPackImageFormat
+    uint32_t mip_count;
+    uint32_t reserved;
+} AssetPackImage;
+
+// NOTE(sokus): Size of one layer of the given mip level, levels halve down to
+// 1x1 and BC7 levels are rounded up to whole blocks.
+size_t AssetPackImageLayerSize(AssetPackImage *image, uint32_t level)
+{
+    size_t width = MAX(image->tile_width >> level, 1u);
+    size_t height = MAX(image->tile_height >> level, 1u);
+    size_t result = (image->format == AssetPackImage_BC7 ?
+                     ((width + 3) / 4) * ((height + 3) / 4) * 16 :
+                     width * height * image->channels);
+    return result;
+}
+
+size_t AssetPackImageDataSize(AssetPackImage *image)
+{
+    size_t layer_count = (size_t)image->tile_count_x * (size_t)image->tile_count_y;
+    size_t result = 0;
+    for(uint32_t level = 0; level < image->mip_count; ++level)
+        result += layer_count * AssetPackImageLayerSize(image, level);
+    return result;
+}
+
+// NOTE(sokus): 64-bit FNV-1a.
+uint64_t HashAssetName(char *name)
+{
+    uint64_t result = 0xcbf29ce484222325ull;
+    for(uint8_t *at = (uint8_t *)name; *at; ++at)
+    {
+        result ^= *at;
+        result *= 0x100000001b3ull;
+    }
+    return result;
+}
+
+typedef struct AssetPack
+{
+    uint8_t *base;
+    size_t size;
+    AssetPackHeader *header;
+    AssetPackEntry *entries;
+} AssetPack;
+
+// NOTE(sokus): Checks everything the lookups rely on, so a truncated or
+// stale pack gets rejected once instead of crashing later.
+bool InitializeAssetPack(AssetPack *pack, void *data, size_t size)
+{
+    MEMORY_SET(pack, 0, sizeof(*pack));
+    AssetPackHeader *header = (AssetPackHeader *)data;
+    bool result = (data && size >= sizeof(AssetPackHeader) &&
+                   header->magic == ASSET_PACK_MAGIC &&
+                   header->version == ASSET_PACK_VERSION &&
+                   header->total_size == size &&
+                   header->entries_offset <= size &&
+                   (size - header->entries_offset) / sizeof(AssetPackEntry) >= header->entry_count);
+
+    AssetPackEntry *entries = result ? (AssetPackEntry *)((uint8_t *)data + header->entries_offset) : 0;
+    for(uint32_t entry_idx = 0; result && entry_idx < header->entry_count; ++entry_idx)
+    {
+        AssetPackEntry *entry = entries + entry_idx;
+        result = (entry->offset <= size && entry->size <= size - entry->offset &&
+                  (entry_idx == 0 || entries[entry_idx - 1].name_hash < entry->name_hash));
+    }
+
+    if(result)
+    {
+        pack->base = (uint8_t *)data;
+        pack->size = size;
+        pack->header = header;
+        pack->entries = entries;
+    }
+    return result;
+}
+
+AssetPackEntry *FindAssetPackEntry(AssetPack *pack, char *name)
+{
+    AssetPackEntry *result = 0;
+    if(pack->header)
+    {
+        uint64_t name_hash = HashAssetName(name);
+        uint32_t first = 0;
+        uint32_t last = pack->header->entry_count;
+        while(first < last)
+        {
+            uint32_t middle = first + (last - first) / 2;
+            AssetPackEntry *entry = pack->entries + middle;
+            if(entry->name_hash == name_hash)
+            {
+                result = entry;
+                break;
+            }
+            else if(entry->name_hash < name_hash)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+    }
+    return result;
+}
+
+void *GetAssetPackData(AssetPack *pack, AssetPackEntry *entry)
+{
+    void *result = pack->base + entry->offset;
+    return result;
+}
+
+#endif //WM_ASSET_PACK_H
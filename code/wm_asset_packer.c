@@ -0,0 +1,413 @@
+// Offline asset packer, bakes the shaders and atlases the game loads into
+// one pack (see wm_asset_pack.h). Images get decoded, tiled, flipped, mipped
+// and compressed here, so the game does none of that at startup.
+//
+//   white-mage-packer.out <repository root> <output pack>
+
+#include "wm_helpers.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wdouble-promotion"
+#pragma GCC diagnostic ignored "-Wconversion"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+#pragma GCC diagnostic pop
+
+#include "wm_image.c"
+#include "wm_asset_pack.h"
+#include "wm_bc7.c"
+
+#define PACKER_MAX_MIP_COUNT 16
+#define PACKER_MAX_THREADS 64
+
+typedef struct PackerSource
+{
+    char *name;
+    char *path; // relative to the repository root
+    AssetPackEntryType type;
+    int tile_width;
+    int tile_height;
+    AssetPackImageFormat format;
+} PackerSource;
+
+// NOTE(sokus): The BC7 encoder only does mode 6 (see wm_bc7.c), which smears
+// sprite blocks holding three or more colors, so sprites stay uncompressed
+// for now. Glyphs are two colors per block and come out exact.
+global PackerSource packer_sources[] = {
+    { "shaders/standard.vs", "code/shaders/standard.vs", AssetPackEntry_Raw, 0, 0, 0 },
+    { "shaders/standard.fs", "code/shaders/standard.fs", AssetPackEntry_Raw, 0, 0, 0 },
+    { "shaders/light.vs", "code/shaders/light.vs", AssetPackEntry_Raw, 0, 0, 0 },
+    { "shaders/light.fs", "code/shaders/light.fs", AssetPackEntry_Raw, 0, 0, 0 },
+    { "textures/sprites", "assets/sprites.png", AssetPackEntry_TileImage, 16, 16, AssetPackImage_Raw },
+    { "textures/glyphs", "assets/glyphs.png", AssetPackEntry_TileImage, 8, 8, AssetPackImage_BC7 },
+};
+
+typedef struct PackerBlob
+{
+    AssetPackEntry entry;
+    char *name;
+    uint8_t *data;
+} PackerBlob;
+
+bool Packer_ReadFile(MemoryArena *arena, char *path, PackerBlob *blob)
+{
+    bool result = false;
+    FILE *file = fopen(path, "rb");
+    if(file)
+    {
+        fseek(file, 0, SEEK_END);
+        long file_size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        if(file_size >= 0)
+        {
+            size_t size = (size_t)file_size;
+            blob->data = (uint8_t *)PUSH_SIZE(arena, size ? size : 1);
+            result = (fread(blob->data, 1, size, file) == size);
+            blob->entry.size = size;
+        }
+        fclose(file);
+    }
+    if(!result)
+        fprintf(stderr, "ERROR: Could not read %s\n", path);
+    return result;
+}
+
+// NOTE(sokus): Images decode in parallel, one thread each, then every tile
+// of every image gets its mips built and encoded on a shared pool. Blobs and
+// tile buffers are sized from the PNG header and pushed up front on the
+// main thread, so the threads only ever write into memory that's already
+// theirs.
+typedef struct PackerImageJob
+{
+    char path[1024];
+    PackerSource *source;
+    PackerBlob *blob;
+    uint8_t *tiles; // decoded and sliced, level 0 of every layer
+    int first_tile; // in the encode pool's numbering
+    size_t level_offsets[PACKER_MAX_MIP_COUNT];
+    bool succeeded;
+} PackerImageJob;
+
+bool Packer_PrepareTileImage(MemoryArena *arena, PackerImageJob *job)
+{
+    int width, height, channels;
+    bool result = (stbi_info(job->path, &width, &height, &channels) != 0);
+    if(result)
+    {
+        PackerSource *source = job->source;
+        AssetPackImage header = {0};
+        header.tile_width = (uint32_t)source->tile_width;
+        header.tile_height = (uint32_t)source->tile_height;
+        header.tile_count_x = (uint32_t)(width / source->tile_width);
+        header.tile_count_y = (uint32_t)(height / source->tile_height);
+        header.channels = (uint32_t)channels;
+        header.format = (uint32_t)source->format;
+        // NOTE(sokus): Full chain, down to 1x1.
+        header.mip_count = 1;
+        while((header.tile_width | header.tile_height) >> header.mip_count)
+            ++header.mip_count;
+        ASSERT(header.mip_count <= PACKER_MAX_MIP_COUNT);
+
+        size_t layer_count = (size_t)(header.tile_count_x * header.tile_count_y);
+        size_t level_offset = sizeof(AssetPackImage);
+        for(uint32_t level = 0; level < header.mip_count; ++level)
+        {
+            job->level_offsets[level] = level_offset;
+            level_offset += layer_count * AssetPackImageLayerSize(&header, level);
+        }
+
+        PackerBlob *blob = job->blob;
+        blob->entry.size = level_offset;
+        blob->data = (uint8_t *)PUSH_SIZE(arena, blob->entry.size);
+        MEMORY_COPY(blob->data, &header, sizeof(header));
+        job->tiles = (uint8_t *)PUSH_SIZE(arena, (size_t)(width * height * channels));
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Could not read image header of %s\n", job->path);
+    }
+    return result;
+}
+
+void *Packer_DecodeTileImage(void *parameter)
+{
+    PackerImageJob *job = (PackerImageJob *)parameter;
+    PackerSource *source = job->source;
+    AssetPackImage *header = (AssetPackImage *)job->blob->data;
+
+    Image image = LoadImageEx(job->path, 0);
+    job->succeeded = (image.data != 0 && (uint32_t)image.channels == header->channels);
+    if(job->succeeded)
+    {
+        job->succeeded = SliceImageTiles(&image, source->tile_width, source->tile_height, job->tiles);
+        if(!job->succeeded)
+        {
+            fprintf(stderr, "ERROR: %s (%dx%d) doesn't split into %dx%d tiles\n",
+                    job->path, image.width, image.height, source->tile_width, source->tile_height);
+        }
+    }
+    if(image.data)
+        UnloadImage(&image);
+    return 0;
+}
+
+typedef struct PackerEncodePool
+{
+    PackerImageJob *jobs;
+    int job_count;
+    int tile_count;
+    atomic_int next_tile;
+} PackerEncodePool;
+
+typedef struct PackerEncodeThread
+{
+    PackerEncodePool *pool;
+    uint8_t *levels[2]; // ping-pong between the current and the next level
+} PackerEncodeThread;
+
+// NOTE(sokus): Tiles are independent (layers never filter into each other),
+// so each one is a work item: build its mip chain and write every level into
+// that layer's slot of the blob.
+void Packer_EncodeTile(PackerImageJob *job, int layer, uint8_t *levels[2])
+{
+    AssetPackImage *header = (AssetPackImage *)job->blob->data;
+    int width = (int)header->tile_width;
+    int height = (int)header->tile_height;
+    int channels = (int)header->channels;
+    size_t tile_size = (size_t)(width * height * channels);
+    MEMORY_COPY(levels[0], job->tiles + (size_t)layer * tile_size, tile_size);
+
+    for(uint32_t level = 0; level < header->mip_count; ++level)
+    {
+        uint8_t *pixels = levels[level & 1];
+        size_t layer_size = AssetPackImageLayerSize(header, level);
+        uint8_t *destination = job->blob->data + job->level_offsets[level] + (size_t)layer * layer_size;
+        if(header->format == AssetPackImage_BC7)
+            EncodeBC7Image(pixels, width, height, channels, destination);
+        else
+            MEMORY_COPY(destination, pixels, layer_size);
+
+        if(level + 1 < header->mip_count)
+        {
+            HalveImagePixels(pixels, width, height, channels, levels[(level + 1) & 1]);
+            width = MAX(width / 2, 1);
+            height = MAX(height / 2, 1);
+        }
+    }
+}
+
+void *Packer_EncodeWorker(void *parameter)
+{
+    PackerEncodeThread *thread = (PackerEncodeThread *)parameter;
+    PackerEncodePool *pool = thread->pool;
+    for(;;)
+    {
+        int tile = atomic_fetch_add_explicit(&pool->next_tile, 1, memory_order_relaxed);
+        if(tile >= pool->tile_count)
+            break;
+
+        int job_idx = pool->job_count - 1;
+        while(pool->jobs[job_idx].first_tile > tile)
+            --job_idx;
+        PackerImageJob *job = pool->jobs + job_idx;
+        Packer_EncodeTile(job, tile - job->first_tile, thread->levels);
+    }
+    return 0;
+}
+
+int Packer_CompareBlobs(const void *a, const void *b)
+{
+    uint64_t hash_a = ((PackerBlob *)a)->entry.name_hash;
+    uint64_t hash_b = ((PackerBlob *)b)->entry.name_hash;
+    int result = (hash_a > hash_b) - (hash_a < hash_b);
+    return result;
+}
+
+void Packer_WritePadding(FILE *file, uint64_t *offset)
+{
+    local_persist uint8_t zeros[ASSET_PACK_ALIGNMENT];
+    size_t padding = AlignUpPow2(*offset, ASSET_PACK_ALIGNMENT) - *offset;
+    fwrite(zeros, 1, padding, file);
+    *offset += padding;
+}
+
+int main(int argument_count, char **arguments)
+{
+    if(argument_count != 3)
+    {
+        fprintf(stderr, "usage: %s <repository root> <output pack>\n", arguments[0]);
+        return 1;
+    }
+    char *root = arguments[1];
+    char *output_path = arguments[2];
+
+    MemoryArena arena;
+    if(!InitializeGrowableArena(&arena, GIGABYTES(4), GIGABYTES(4)))
+    {
+        fprintf(stderr, "ERROR: Could not reserve memory\n");
+        return 1;
+    }
+
+    int blob_count = (int)ARRAY_SIZE(packer_sources);
+    PackerBlob *blobs = PUSH_ARRAY(&arena, PackerBlob, (size_t)blob_count);
+    PackerImageJob *image_jobs = PUSH_ARRAY(&arena, PackerImageJob, (size_t)blob_count);
+    pthread_t *image_threads = PUSH_ARRAY(&arena, pthread_t, (size_t)blob_count);
+    int image_job_count = 0;
+    bool succeeded = true;
+    for(int source_idx = 0; succeeded && source_idx < blob_count; ++source_idx)
+    {
+        PackerSource *source = packer_sources + source_idx;
+        PackerBlob *blob = blobs + source_idx;
+        MEMORY_SET(blob, 0, sizeof(*blob));
+        blob->name = source->name;
+        blob->entry.name_hash = HashAssetName(source->name);
+        blob->entry.type = (uint32_t)source->type;
+
+        if(source->type == AssetPackEntry_TileImage)
+        {
+            PackerImageJob *job = image_jobs + image_job_count;
+            snprintf(job->path, sizeof(job->path), "%s/%s", root, source->path);
+            job->source = source;
+            job->blob = blob;
+            job->succeeded = false;
+            succeeded = Packer_PrepareTileImage(&arena, job);
+            if(succeeded)
+                ++image_job_count;
+        }
+        else
+        {
+            char path[1024];
+            snprintf(path, sizeof(path), "%s/%s", root, source->path);
+            succeeded = Packer_ReadFile(&arena, path, blob);
+        }
+    }
+
+    int started_count = 0;
+    for(; started_count < image_job_count; ++started_count)
+    {
+        if(pthread_create(image_threads + started_count, 0, Packer_DecodeTileImage, image_jobs + started_count) != 0)
+        {
+            fprintf(stderr, "ERROR: Could not start image thread\n");
+            succeeded = false;
+            break;
+        }
+    }
+    for(int job_idx = 0; job_idx < started_count; ++job_idx)
+    {
+        pthread_join(image_threads[job_idx], 0);
+        succeeded = succeeded && image_jobs[job_idx].succeeded;
+    }
+    if(started_count < image_job_count)
+        succeeded = false;
+
+    if(succeeded && image_job_count > 0)
+    {
+        PackerEncodePool pool = {0};
+        pool.jobs = image_jobs;
+        pool.job_count = image_job_count;
+        size_t max_tile_size = 0;
+        for(int job_idx = 0; job_idx < image_job_count; ++job_idx)
+        {
+            AssetPackImage *header = (AssetPackImage *)image_jobs[job_idx].blob->data;
+            image_jobs[job_idx].first_tile = pool.tile_count;
+            pool.tile_count += (int)(header->tile_count_x * header->tile_count_y);
+            max_tile_size = MAX(max_tile_size, (size_t)(header->tile_width * header->tile_height * header->channels));
+        }
+
+        int thread_count = CLAMP(1, (int)sysconf(_SC_NPROCESSORS_ONLN), PACKER_MAX_THREADS);
+        thread_count = MIN(thread_count, pool.tile_count);
+        PackerEncodeThread *encode_threads = PUSH_ARRAY(&arena, PackerEncodeThread, (size_t)thread_count);
+        pthread_t *encode_thread_handles = PUSH_ARRAY(&arena, pthread_t, (size_t)thread_count);
+        for(int thread_idx = 0; thread_idx < thread_count; ++thread_idx)
+        {
+            encode_threads[thread_idx].pool = &pool;
+            encode_threads[thread_idx].levels[0] = (uint8_t *)PUSH_SIZE(&arena, max_tile_size);
+            encode_threads[thread_idx].levels[1] = (uint8_t *)PUSH_SIZE(&arena, max_tile_size);
+        }
+
+        // NOTE(sokus): The main thread works too, so a failed create only
+        // means fewer helpers.
+        int helper_count = 0;
+        for(; helper_count + 1 < thread_count; ++helper_count)
+        {
+            if(pthread_create(encode_thread_handles + helper_count, 0, Packer_EncodeWorker,
+                              encode_threads + helper_count + 1) != 0)
+                break;
+        }
+        Packer_EncodeWorker(encode_threads);
+        for(int thread_idx = 0; thread_idx < helper_count; ++thread_idx)
+            pthread_join(encode_thread_handles[thread_idx], 0);
+    }
+
+    if(succeeded)
+    {
+        qsort(blobs, (size_t)blob_count, sizeof(PackerBlob), Packer_CompareBlobs);
+        for(int blob_idx = 1; blob_idx < blob_count; ++blob_idx)
+        {
+            if(blobs[blob_idx - 1].entry.name_hash == blobs[blob_idx].entry.name_hash)
+            {
+                fprintf(stderr, "ERROR: %s and %s hash to the same value\n",
+                        blobs[blob_idx - 1].name, blobs[blob_idx].name);
+                succeeded = false;
+            }
+        }
+    }
+
+    if(succeeded)
+    {
+        AssetPackHeader header = {0};
+        header.magic = ASSET_PACK_MAGIC;
+        header.version = ASSET_PACK_VERSION;
+        header.entry_count = (uint32_t)blob_count;
+        header.entries_offset = AlignUpPow2(sizeof(AssetPackHeader), ASSET_PACK_ALIGNMENT);
+
+        uint64_t offset = header.entries_offset + (uint64_t)blob_count * sizeof(AssetPackEntry);
+        for(int blob_idx = 0; blob_idx < blob_count; ++blob_idx)
+        {
+            offset = AlignUpPow2(offset, ASSET_PACK_ALIGNMENT);
+            blobs[blob_idx].entry.offset = offset;
+            offset += blobs[blob_idx].entry.size;
+        }
+        header.total_size = offset;
+
+        FILE *file = fopen(output_path, "wb");
+        succeeded = (file != 0);
+        if(file)
+        {
+            uint64_t written = 0;
+            fwrite(&header, sizeof(header), 1, file);
+            written += sizeof(header);
+            Packer_WritePadding(file, &written);
+            for(int blob_idx = 0; blob_idx < blob_count; ++blob_idx)
+            {
+                fwrite(&blobs[blob_idx].entry, sizeof(AssetPackEntry), 1, file);
+                written += sizeof(AssetPackEntry);
+            }
+            for(int blob_idx = 0; blob_idx < blob_count; ++blob_idx)
+            {
+                Packer_WritePadding(file, &written);
+                fwrite(blobs[blob_idx].data, 1, blobs[blob_idx].entry.size, file);
+                written += blobs[blob_idx].entry.size;
+            }
+            succeeded = (ferror(file) == 0 && written == header.total_size);
+            fclose(file);
+        }
+
+        if(succeeded)
+            printf("Packed %d assets into %s (%llu bytes)\n", blob_count, output_path,
+                   (unsigned long long)header.total_size);
+        else
+            fprintf(stderr, "ERROR: Could not write %s\n", output_path);
+    }
+
+    ReleaseArena(&arena);
+    return succeeded ? 0 : 1;
+}
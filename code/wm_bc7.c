@@ -0,0 +1,252 @@
+// NOTE(sokus): BC7 encoder for the asset packer, mode 6 only: one subset,
+// RGBA endpoints with 7 bits per channel plus a p-bit, 4-bit indices. That
+// covers both our RGB and RGBA atlases at a fixed 8 bits per pixel, and the
+// blocks it can't represent well (several unrelated colors) don't show up
+// much in pixel art. Meant for offline use, speed wasn't a goal.
+
+#define BC7_BLOCK_SIZE 16
+
+global int bc7_weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+typedef struct BC7BitWriter
+{
+    uint8_t *bytes;
+    int bit_position;
+} BC7BitWriter;
+
+void BC7_WriteBits(BC7BitWriter *writer, uint32_t value, int bit_count)
+{
+    for(int bit_idx = 0; bit_idx < bit_count; ++bit_idx)
+    {
+        int position = writer->bit_position++;
+        if(value & (1u << bit_idx))
+            writer->bytes[position >> 3] |= (uint8_t)(1u << (position & 7));
+    }
+}
+
+int BC7_Interpolate(int e0, int e1, int index)
+{
+    int weight = bc7_weights4[index];
+    int result = ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+    return result;
+}
+
+// NOTE(sokus): Picks the best index for every pixel against the quantized
+// endpoints, returns the summed squared error.
+uint32_t BC7_SelectIndices(uint8_t pixels[16][4], int endpoints[2][4], uint8_t *indices)
+{
+    int palette[16][4];
+    for(int index = 0; index < 16; ++index)
+        for(int channel = 0; channel < 4; ++channel)
+            palette[index][channel] = BC7_Interpolate(endpoints[0][channel], endpoints[1][channel], index);
+
+    uint32_t result = 0;
+    for(int pixel_idx = 0; pixel_idx < 16; ++pixel_idx)
+    {
+        uint32_t best_error = UINT32_MAX;
+        for(int index = 0; index < 16; ++index)
+        {
+            uint32_t error = 0;
+            for(int channel = 0; channel < 4; ++channel)
+            {
+                int difference = palette[index][channel] - pixels[pixel_idx][channel];
+                error += (uint32_t)(difference * difference);
+            }
+            if(error < best_error)
+            {
+                best_error = error;
+                indices[pixel_idx] = (uint8_t)index;
+            }
+        }
+        result += best_error;
+    }
+    return result;
+}
+
+// NOTE(sokus): Endpoint values are 7 bits plus a shared p-bit per endpoint,
+// tries all four p-bit pairs and keeps the best.
+uint32_t BC7_QuantizeAndSelect(uint8_t pixels[16][4], float unquantized[2][4],
+                               int endpoints[2][4], int p_bits[2], uint8_t *indices)
+{
+    uint32_t result = UINT32_MAX;
+    for(int p_combination = 0; p_combination < 4; ++p_combination)
+    {
+        int candidate[2][4];
+        int candidate_p[2] = { p_combination & 1, p_combination >> 1 };
+        for(int endpoint_idx = 0; endpoint_idx < 2; ++endpoint_idx)
+        {
+            for(int channel = 0; channel < 4; ++channel)
+            {
+                float value = (unquantized[endpoint_idx][channel] - (float)candidate_p[endpoint_idx]) * 0.5f;
+                int quantized = CLAMP(0, (int)(value + 0.5f), 127);
+                candidate[endpoint_idx][channel] = (quantized << 1) | candidate_p[endpoint_idx];
+            }
+        }
+
+        uint8_t candidate_indices[16];
+        uint32_t error = BC7_SelectIndices(pixels, candidate, candidate_indices);
+        if(error < result)
+        {
+            result = error;
+            MEMORY_COPY(endpoints, candidate, sizeof(candidate));
+            p_bits[0] = candidate_p[0];
+            p_bits[1] = candidate_p[1];
+            MEMORY_COPY(indices, candidate_indices, sizeof(candidate_indices));
+        }
+    }
+    return result;
+}
+
+void EncodeBC7Block(uint8_t pixels[16][4], uint8_t *block)
+{
+    // NOTE(sokus): Endpoints start on the principal axis of the colors
+    // (power iteration on the covariance), spanning the projections.
+    float mean[4] = {0};
+    for(int pixel_idx = 0; pixel_idx < 16; ++pixel_idx)
+        for(int channel = 0; channel < 4; ++channel)
+            mean[channel] += (float)pixels[pixel_idx][channel] / 16.0f;
+
+    float covariance[4][4] = {0};
+    for(int pixel_idx = 0; pixel_idx < 16; ++pixel_idx)
+    {
+        float centered[4];
+        for(int channel = 0; channel < 4; ++channel)
+            centered[channel] = (float)pixels[pixel_idx][channel] - mean[channel];
+        for(int row = 0; row < 4; ++row)
+            for(int column = 0; column < 4; ++column)
+                covariance[row][column] += centered[row] * centered[column];
+    }
+
+    float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for(int iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[4] = {0};
+        float length_squared = 0.0f;
+        for(int row = 0; row < 4; ++row)
+        {
+            for(int column = 0; column < 4; ++column)
+                next[row] += covariance[row][column] * axis[column];
+            length_squared += next[row] * next[row];
+        }
+        if(length_squared < 1e-8f)
+            break;
+        float inverse_length = 1.0f / sqrtf(length_squared);
+        for(int channel = 0; channel < 4; ++channel)
+            axis[channel] = next[channel] * inverse_length;
+    }
+
+    float t_min = 0.0f;
+    float t_max = 0.0f;
+    for(int pixel_idx = 0; pixel_idx < 16; ++pixel_idx)
+    {
+        float t = 0.0f;
+        for(int channel = 0; channel < 4; ++channel)
+            t += ((float)pixels[pixel_idx][channel] - mean[channel]) * axis[channel];
+        t_min = MIN(t_min, t);
+        t_max = MAX(t_max, t);
+    }
+
+    float unquantized[2][4];
+    for(int channel = 0; channel < 4; ++channel)
+    {
+        unquantized[0][channel] = CLAMP(0.0f, mean[channel] + axis[channel] * t_min, 255.0f);
+        unquantized[1][channel] = CLAMP(0.0f, mean[channel] + axis[channel] * t_max, 255.0f);
+    }
+
+    int endpoints[2][4];
+    int p_bits[2];
+    uint8_t indices[16];
+    uint32_t error = BC7_QuantizeAndSelect(pixels, unquantized, endpoints, p_bits, indices);
+
+    // NOTE(sokus): One least squares refit of the endpoints for the chosen
+    // indices, kept only if it actually lowers the error.
+    if(error > 0)
+    {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[4] = {0}, bx[4] = {0};
+        for(int pixel_idx = 0; pixel_idx < 16; ++pixel_idx)
+        {
+            float w = (float)bc7_weights4[indices[pixel_idx]] / 64.0f;
+            float a = 1.0f - w;
+            aa += a * a;
+            ab += a * w;
+            bb += w * w;
+            for(int channel = 0; channel < 4; ++channel)
+            {
+                ax[channel] += a * (float)pixels[pixel_idx][channel];
+                bx[channel] += w * (float)pixels[pixel_idx][channel];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if(determinant > 1e-6f)
+        {
+            float refit[2][4];
+            for(int channel = 0; channel < 4; ++channel)
+            {
+                refit[0][channel] = CLAMP(0.0f, (bb * ax[channel] - ab * bx[channel]) / determinant, 255.0f);
+                refit[1][channel] = CLAMP(0.0f, (aa * bx[channel] - ab * ax[channel]) / determinant, 255.0f);
+            }
+            int refit_endpoints[2][4];
+            int refit_p_bits[2];
+            uint8_t refit_indices[16];
+            uint32_t refit_error = BC7_QuantizeAndSelect(pixels, refit, refit_endpoints, refit_p_bits, refit_indices);
+            if(refit_error < error)
+            {
+                MEMORY_COPY(endpoints, refit_endpoints, sizeof(endpoints));
+                MEMORY_COPY(p_bits, refit_p_bits, sizeof(p_bits));
+                MEMORY_COPY(indices, refit_indices, sizeof(indices));
+            }
+        }
+    }
+
+    // NOTE(sokus): The first index is stored without its top bit, so it has
+    // to be below 8. Swapping the endpoints flips all the indices.
+    if(indices[0] >= 8)
+    {
+        for(int channel = 0; channel < 4; ++channel)
+            SWAP(endpoints[0][channel], endpoints[1][channel], int);
+        SWAP(p_bits[0], p_bits[1], int);
+        for(int pixel_idx = 0; pixel_idx < 16; ++pixel_idx)
+            indices[pixel_idx] = (uint8_t)(15 - indices[pixel_idx]);
+    }
+
+    MEMORY_SET(block, 0, BC7_BLOCK_SIZE);
+    BC7BitWriter writer = { block, 0 };
+    BC7_WriteBits(&writer, 1u << 6, 7); // mode 6
+    for(int channel = 0; channel < 4; ++channel)
+    {
+        BC7_WriteBits(&writer, (uint32_t)(endpoints[0][channel] >> 1), 7);
+        BC7_WriteBits(&writer, (uint32_t)(endpoints[1][channel] >> 1), 7);
+    }
+    BC7_WriteBits(&writer, (uint32_t)p_bits[0], 1);
+    BC7_WriteBits(&writer, (uint32_t)p_bits[1], 1);
+    BC7_WriteBits(&writer, indices[0], 3);
+    for(int pixel_idx = 1; pixel_idx < 16; ++pixel_idx)
+        BC7_WriteBits(&writer, indices[pixel_idx], 4);
+    ASSERT(writer.bit_position == 128);
+}
+
+// NOTE(sokus): Encodes one image of RGB or RGBA pixels, edge pixels get
+// repeated into blocks that hang over the border (levels smaller than 4x4).
+void EncodeBC7Image(uint8_t *pixels, int width, int height, int channels, uint8_t *blocks)
+{
+    for(int block_y = 0; block_y < height; block_y += 4)
+    {
+        for(int block_x = 0; block_x < width; block_x += 4)
+        {
+            uint8_t block_pixels[16][4];
+            for(int pixel_idx = 0; pixel_idx < 16; ++pixel_idx)
+            {
+                int x = MIN(block_x + (pixel_idx & 3), width - 1);
+                int y = MIN(block_y + (pixel_idx >> 2), height - 1);
+                uint8_t *pixel = pixels + (size_t)(y * width + x) * (size_t)channels;
+                block_pixels[pixel_idx][0] = pixel[0];
+                block_pixels[pixel_idx][1] = pixel[1];
+                block_pixels[pixel_idx][2] = pixel[2];
+                block_pixels[pixel_idx][3] = (channels == 4) ? pixel[3] : 255;
+            }
+            EncodeBC7Block(block_pixels, blocks);
+            blocks += BC7_BLOCK_SIZE;
+        }
+    }
+}
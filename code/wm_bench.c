@@ -0,0 +1,512 @@
+// Headless micro-benchmarks for the wm_math.h and wm_helpers.h primitives,
+// no SDL or GL involved. Built by build.sh as white-mage-bench.out.
+//
+//   white-mage-bench.out         human readable table
+//   white-mage-bench.out --csv   a "group,name,ns_per_op,mops_per_second,max_error"
+//                                row per benchmark, for diffing between commits
+//
+// The SIMD vs scalar agreement check lives in wm_math_check.c.
+
+#include "wm_helpers.h"
+#include "wm_math.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_INPUT_COUNT 4096
+#define BENCH_REPEATS 256
+#define BENCH_MAX_RESULTS 64
+
+typedef struct BenchResult
+{
+    char *group;
+    char *name;
+    double ns_per_op;
+    double mops_per_second;
+    double max_error;
+} BenchResult;
+
+global BenchResult bench_results[BENCH_MAX_RESULTS];
+global int bench_result_count;
+global char *bench_group = "";
+
+// NOTE(sokus): Results are summed into this so the compiler can't throw
+// the benchmarked work away.
+global volatile float bench_sink;
+
+uint64_t Bench_GetNanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t result = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+    return result;
+}
+
+float Bench_RandomFloat(float min, float max)
+{
+    float t = (float)rand() / (float)RAND_MAX;
+    float result = min + t * (max - min);
+    return result;
+}
+
+vec3 Bench_RandomVec3(float min, float max)
+{
+    vec3 result = Vec3(Bench_RandomFloat(min, max),
+                       Bench_RandomFloat(min, max),
+                       Bench_RandomFloat(min, max));
+    return result;
+}
+
+mat4 Bench_RandomMat4(void)
+{
+    mat4 result;
+    for(int col_idx = 0; col_idx < 4; ++col_idx)
+        for(int row_idx = 0; row_idx < 4; ++row_idx)
+            result.elements[col_idx][row_idx] = Bench_RandomFloat(-2.0f, 2.0f);
+    return result;
+}
+
+void Bench_Record(char *name, uint64_t nanoseconds, uint64_t op_count, double max_error)
+{
+    ASSERT(bench_result_count < BENCH_MAX_RESULTS);
+    BenchResult *result = bench_results + bench_result_count++;
+    result->group = bench_group;
+    result->name = name;
+    result->ns_per_op = (double)nanoseconds / (double)op_count;
+    result->mops_per_second = 1000.0 / result->ns_per_op;
+    result->max_error = max_error;
+}
+
+// Runs body BENCH_REPEATS times and records the time per op, where one
+// run of the body does ops_per_repeat ops.
+#define BENCH(name, ops_per_repeat, max_error, body) STATEMENT(\
+uint64_t start = Bench_GetNanoseconds();\
+for(int repeat_idx = 0; repeat_idx < BENCH_REPEATS; ++repeat_idx)\
+{\
+body\
+}\
+uint64_t end = Bench_GetNanoseconds();\
+Bench_Record(name, end - start, (uint64_t)(ops_per_repeat) * BENCH_REPEATS, max_error);\
+)
+
+// Evaluates expression for every input, the expression sees the input as x.
+#define BENCH_UNARY(name, inputs, expression, max_error) STATEMENT(\
+float sum = 0.0f;\
+BENCH(name, BENCH_INPUT_COUNT, max_error,\
+      for(int input_idx = 0; input_idx < BENCH_INPUT_COUNT; ++input_idx)\
+      {\
+          float x = (inputs)[input_idx];\
+          sum += (expression);\
+      });\
+bench_sink += sum;\
+)
+
+// Max abs (or relative) difference between an approximation and the CRT.
+#define BENCH_ERROR(inputs, approximation, reference, relative) ({\
+double max_error = 0.0;\
+for(int input_idx = 0; input_idx < BENCH_INPUT_COUNT; ++input_idx)\
+{\
+float x = (inputs)[input_idx];\
+double approximate = (double)(approximation);\
+double exact = (double)(reference);\
+double error = approximate - exact;\
+if(relative) error /= exact;\
+if(error < 0.0) error = -error;\
+if(error > max_error) max_error = error;\
+}\
+max_error;\
+})
+
+//~NOTE(sokus): fast math
+
+float Bench_SinCosSum(float x, bool fast)
+{
+    float sin_value, cos_value;
+    if(fast)
+        FastSinCosF(x, &sin_value, &cos_value);
+    else
+    {
+        sin_value = SINF(x);
+        cos_value = COSF(x);
+    }
+    float result = sin_value + cos_value;
+    return result;
+}
+
+void Bench_FastMath(void)
+{
+    static float angles[BENCH_INPUT_COUNT];
+    static float positives[BENCH_INPUT_COUNT];
+    static float exponents[BENCH_INPUT_COUNT];
+    for(int input_idx = 0; input_idx < BENCH_INPUT_COUNT; ++input_idx)
+    {
+        angles[input_idx] = Bench_RandomFloat(-100.0f, 100.0f);
+        positives[input_idx] = Bench_RandomFloat(0.001f, 1000.0f);
+        exponents[input_idx] = Bench_RandomFloat(-20.0f, 20.0f);
+    }
+
+    bench_group = "fast_math";
+    BENCH_UNARY("sinf", angles, SINF(x), 0.0);
+    BENCH_UNARY("FastSinF", angles, FastSinF(x),
+                BENCH_ERROR(angles, FastSinF(x), sin((double)x), false));
+    BENCH_UNARY("cosf", angles, COSF(x), 0.0);
+    BENCH_UNARY("FastCosF", angles, FastCosF(x),
+                BENCH_ERROR(angles, FastCosF(x), cos((double)x), false));
+    BENCH_UNARY("sinf+cosf", angles, Bench_SinCosSum(x, false), 0.0);
+    BENCH_UNARY("FastSinCosF", angles, Bench_SinCosSum(x, true),
+                BENCH_ERROR(angles, Bench_SinCosSum(x, true), sin((double)x) + cos((double)x), false));
+    BENCH_UNARY("1/sqrtf", positives, 1.0f / SQRTF(x), 0.0);
+    BENCH_UNARY("FastRSquareRootF", positives, FastRSquareRootF(x),
+                BENCH_ERROR(positives, FastRSquareRootF(x), 1.0 / sqrt((double)x), true));
+    BENCH_UNARY("exp2f", exponents, EXP2F(x), 0.0);
+    BENCH_UNARY("FastExp2F", exponents, FastExp2F(x),
+                BENCH_ERROR(exponents, FastExp2F(x), exp2((double)x), true));
+    BENCH_UNARY("log2f", positives, LOG2F(x), 0.0);
+    BENCH_UNARY("FastLog2F", positives, FastLog2F(x),
+                BENCH_ERROR(positives, FastLog2F(x), log2((double)x), false));
+    BENCH_UNARY("expf(logf)", positives, EXPF(1.7f * LOGF(x)), 0.0);
+    BENCH_UNARY("FastPowerF", positives, FastPowerF(x, 1.7f),
+                BENCH_ERROR(positives, FastPowerF(x, 1.7f), pow((double)x, 1.7), true));
+}
+
+//~NOTE(sokus): vectors and matrices
+
+void Bench_Math(void)
+{
+    static mat4 matrices_a[BENCH_INPUT_COUNT];
+    static mat4 matrices_b[BENCH_INPUT_COUNT];
+    static mat4 matrices_out[BENCH_INPUT_COUNT];
+    static vec4 vectors4[BENCH_INPUT_COUNT];
+    static vec3 vectors3[BENCH_INPUT_COUNT];
+    static vec3 targets[BENCH_INPUT_COUNT];
+    static quat quats_a[BENCH_INPUT_COUNT];
+    static quat quats_b[BENCH_INPUT_COUNT];
+    for(int input_idx = 0; input_idx < BENCH_INPUT_COUNT; ++input_idx)
+    {
+        matrices_a[input_idx] = Bench_RandomMat4();
+        matrices_b[input_idx] = Bench_RandomMat4();
+        vectors4[input_idx] = Vec4v(Bench_RandomVec3(-10.0f, 10.0f), 1.0f);
+        vectors3[input_idx] = Bench_RandomVec3(-10.0f, 10.0f);
+        targets[input_idx] = Bench_RandomVec3(-10.0f, 10.0f);
+        quats_a[input_idx] = QuatFromAxisAngle(Bench_RandomFloat(-180.0f, 180.0f), Bench_RandomVec3(-1.0f, 1.0f));
+        quats_b[input_idx] = QuatFromAxisAngle(Bench_RandomFloat(-180.0f, 180.0f), Bench_RandomVec3(-1.0f, 1.0f));
+    }
+
+    bench_group = "math";
+    float sum = 0.0f;
+
+    BENCH("MultiplyMat4", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              matrices_out[idx] = MultiplyMat4(matrices_a[idx], matrices_b[idx]););
+    BENCH("MultiplyMat4Scalar", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              matrices_out[idx] = MultiplyMat4Scalar(matrices_a[idx], matrices_b[idx]););
+    BENCH("MultiplyMat4ByVec4", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              sum += MultiplyMat4ByVec4(matrices_a[idx], vectors4[idx]).x;);
+    BENCH("Transpose", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              matrices_out[idx] = Transpose(matrices_a[idx]););
+    BENCH("InverseMat4", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              matrices_out[idx] = InverseMat4(matrices_a[idx]););
+    BENCH("Translate(Rotate(Scale))", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+          {
+              vec3 v = vectors3[idx];
+              mat4 model = Scale(Mat4d(1.0f), 0.5f, 0.5f, 0.5f);
+              model = Rotate(model, v.x, v.y, v.z, 1.0f);
+              matrices_out[idx] = Translate(model, v.x, v.y, v.z);
+          });
+    BENCH("Mat4FromTRS", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+          {
+              vec3 v = vectors3[idx];
+              matrices_out[idx] = Mat4FromTRS(v, v.x, Vec3(v.y, v.z, 1.0f), Vec3(0.5f, 0.5f, 0.5f));
+          });
+    BENCH("LookAt", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              matrices_out[idx] = LookAt(vectors3[idx], targets[idx], Vec3(0.0f, 1.0f, 0.0f)););
+    BENCH("NormalizeVec3", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              sum += NormalizeVec3(vectors3[idx]).x;);
+    BENCH("Cross", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              sum += Cross(vectors3[idx], targets[idx]).y;);
+    BENCH("MultiplyQuat", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              sum += MultiplyQuat(quats_a[idx], quats_b[idx]).w;);
+    BENCH("NormalizeQuat", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              sum += NormalizeQuat(quats_a[idx]).w;);
+    BENCH("NLerp", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              sum += NLerp(quats_a[idx], 0.3f, quats_b[idx]).w;);
+    BENCH("SLerp", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              sum += SLerp(quats_a[idx], 0.3f, quats_b[idx]).w;);
+    BENCH("Mat4FromQuat", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              matrices_out[idx] = Mat4FromQuat(quats_a[idx]););
+    Frustum frustum = FrustumFromMatrix(MultiplyMat4(Perspective(40.0f, 16.0f / 9.0f, 0.1f, 100.0f),
+                                                     LookAt(Vec3(0.0f, 2.0f, 5.0f), Vec3(0.0f, 0.0f, 0.0f),
+                                                            Vec3(0.0f, 1.0f, 0.0f))));
+    BENCH("SphereInFrustum", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              sum += (float)SphereInFrustum(&frustum, vectors3[idx], 0.5f););
+
+    bench_sink += sum + matrices_out[BENCH_INPUT_COUNT / 2].elements[1][2];
+}
+
+// NOTE(sokus): Kept out of Bench_Math, which is big enough that gcc stops
+// inlining the math calls into it. The generic functions run on the same
+// affine inputs for comparison.
+void Bench_Affine(void)
+{
+    static mat4 matrices_a[BENCH_INPUT_COUNT];
+    static mat4 matrices_b[BENCH_INPUT_COUNT];
+    static mat4 matrices_out[BENCH_INPUT_COUNT];
+    for(int input_idx = 0; input_idx < BENCH_INPUT_COUNT; ++input_idx)
+    {
+        matrices_a[input_idx] = Mat4FromTRS(Bench_RandomVec3(-10.0f, 10.0f), Bench_RandomFloat(-180.0f, 180.0f),
+                                            Bench_RandomVec3(-1.0f, 1.0f), Bench_RandomVec3(0.5f, 2.0f));
+        matrices_b[input_idx] = Mat4FromTRS(Bench_RandomVec3(-10.0f, 10.0f), Bench_RandomFloat(-180.0f, 180.0f),
+                                            Bench_RandomVec3(-1.0f, 1.0f), Bench_RandomVec3(0.5f, 2.0f));
+    }
+
+    bench_group = "affine";
+    BENCH("MultiplyMat4", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              matrices_out[idx] = MultiplyMat4(matrices_a[idx], matrices_b[idx]););
+    BENCH("MultiplyAffine", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              matrices_out[idx] = MultiplyAffine(matrices_a[idx], matrices_b[idx]););
+    BENCH("InverseMat4", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              matrices_out[idx] = InverseMat4(matrices_a[idx]););
+    BENCH("InverseAffine", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              matrices_out[idx] = InverseAffine(matrices_a[idx]););
+
+    bench_sink += matrices_out[BENCH_INPUT_COUNT / 2].elements[3][0];
+}
+
+void Bench_BatchTransforms(void)
+{
+    static float transform_data[10][BENCH_INPUT_COUNT];
+    static mat4 matrices_out[BENCH_INPUT_COUNT];
+    for(int input_idx = 0; input_idx < BENCH_INPUT_COUNT; ++input_idx)
+    {
+        for(int array_idx = 0; array_idx < 10; ++array_idx)
+            transform_data[array_idx][input_idx] = Bench_RandomFloat(-2.0f, 2.0f);
+    }
+
+    TransformArrays transforms;
+    transforms.position_x = transform_data[0];
+    transforms.position_y = transform_data[1];
+    transforms.position_z = transform_data[2];
+    transforms.rotation_x = transform_data[3];
+    transforms.rotation_y = transform_data[4];
+    transforms.rotation_z = transform_data[5];
+    transforms.rotation_w = transform_data[6];
+    transforms.scale_x = transform_data[7];
+    transforms.scale_y = transform_data[8];
+    transforms.scale_z = transform_data[9];
+    NormalizeQuatArrays(transforms.rotation_x, transforms.rotation_y,
+                        transforms.rotation_z, transforms.rotation_w, BENCH_INPUT_COUNT);
+
+    mat4 view = LookAt(Vec3(0.0f, 2.0f, 5.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f));
+    mat4 view_projection = MultiplyMat4(Perspective(40.0f, 1.7f, 0.1f, 100.0f), view);
+
+    bench_group = "batch";
+    BENCH("ComposeModelMatrices", BENCH_INPUT_COUNT, 0.0,
+          ComposeModelMatrices(&transforms, 0, BENCH_INPUT_COUNT, matrices_out, sizeof(mat4)););
+    BENCH("ComposeModelMatricesScalar", BENCH_INPUT_COUNT, 0.0,
+          ComposeModelMatricesScalar(&transforms, 0, BENCH_INPUT_COUNT, matrices_out, sizeof(mat4)););
+    BENCH("MultiplyMat4Batch", BENCH_INPUT_COUNT, 0.0,
+          MultiplyMat4Batch(&view_projection, matrices_out, sizeof(mat4),
+                            matrices_out, sizeof(mat4), BENCH_INPUT_COUNT););
+    BENCH("MultiplyAffineBatch", BENCH_INPUT_COUNT, 0.0,
+          MultiplyAffineBatch(&view, matrices_out, sizeof(mat4),
+                              matrices_out, sizeof(mat4), BENCH_INPUT_COUNT););
+    BENCH("NormalizeQuatArrays", BENCH_INPUT_COUNT, 0.0,
+          NormalizeQuatArrays(transforms.rotation_x, transforms.rotation_y,
+                              transforms.rotation_z, transforms.rotation_w, BENCH_INPUT_COUNT););
+
+    bench_sink += matrices_out[BENCH_INPUT_COUNT / 2].elements[3][0];
+}
+
+//~NOTE(sokus): helpers
+
+typedef struct BenchNode
+{
+    struct BenchNode *next;
+    struct BenchNode *prev;
+    int value;
+} BenchNode;
+
+void Bench_Helpers(void)
+{
+    static size_t push_sizes[BENCH_INPUT_COUNT];
+    for(int input_idx = 0; input_idx < BENCH_INPUT_COUNT; ++input_idx)
+        push_sizes[input_idx] = (size_t)(rand() % 256 + 1);
+
+    static uint8_t arena_buffer[BENCH_INPUT_COUNT * 512];
+    MemoryArena arena;
+    InitializeArena(&arena, arena_buffer, sizeof(arena_buffer));
+
+    static BenchNode nodes[BENCH_INPUT_COUNT];
+    for(int node_idx = 0; node_idx < BENCH_INPUT_COUNT; ++node_idx)
+        nodes[node_idx].value = node_idx;
+
+    bench_group = "helpers";
+    uintptr_t pointer_sum = 0;
+    int value_sum = 0;
+
+    BENCH("MemoryArenaPushSize", BENCH_INPUT_COUNT, 0.0,
+          ClearArena(&arena);
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              pointer_sum += (uintptr_t)MemoryArenaPushSize(&arena, push_sizes[idx]););
+#if WM_VIRTUAL_MEMORY
+    // NOTE(sokus): The threshold sits below what one repeat pushes, so every
+    // repeat pays for the mprotect calls that recommit the pages past it.
+    MemoryArena growable_arena;
+    if(InitializeGrowableArena(&growable_arena, GIGABYTES(1), KILOBYTES(256)))
+    {
+        BENCH("MemoryArenaPushSize growable", BENCH_INPUT_COUNT, 0.0,
+              ClearArena(&growable_arena);
+              for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+                  pointer_sum += (uintptr_t)MemoryArenaPushSize(&growable_arena, push_sizes[idx]););
+        ReleaseArena(&growable_arena);
+    }
+#endif
+    BENCH("MemoryArenaPushSizeAligned", BENCH_INPUT_COUNT, 0.0,
+          ClearArena(&arena);
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              pointer_sum += (uintptr_t)MemoryArenaPushSizeAligned(&arena, push_sizes[idx], 16););
+    static uint8_t shared_buffer[BENCH_INPUT_COUNT * 512];
+    SharedArena shared_arena;
+    InitializeSharedArena(&shared_arena, shared_buffer, sizeof(shared_buffer));
+    BENCH("SharedArenaPushSizeAligned", BENCH_INPUT_COUNT, 0.0,
+          ClearSharedArena(&shared_arena);
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              pointer_sum += (uintptr_t)SharedArenaPushSizeAligned(&shared_arena, push_sizes[idx], 16););
+    BENCH("TemporaryMemory", BENCH_INPUT_COUNT, 0.0,
+          ClearArena(&arena);
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+          {
+              TemporaryMemory temporary_memory = BeginTemporaryMemory(&arena);
+              pointer_sum += (uintptr_t)PUSH_SIZE(&arena, push_sizes[idx]);
+              EndTemporaryMemory(temporary_memory);
+          });
+    BENCH("MemoryArenaPushPop", BENCH_INPUT_COUNT, 0.0,
+          ClearArena(&arena);
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+          {
+              pointer_sum += (uintptr_t)MemoryArenaPushSize(&arena, push_sizes[idx]);
+              MemoryArenaPopSize(&arena, push_sizes[idx]);
+          });
+
+    BENCH("SLL_STACK_PUSH+POP", BENCH_INPUT_COUNT, 0.0,
+          BenchNode *stack = 0;
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              SLL_STACK_PUSH(stack, nodes + idx);
+          while(stack)
+          {
+              value_sum += stack->value;
+              SLL_STACK_POP(stack);
+          });
+    BENCH("SLL_QUEUE_PUSH_BACK+POP", BENCH_INPUT_COUNT, 0.0,
+          BenchNode *first = 0;
+          BenchNode *last = 0;
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              SLL_QUEUE_PUSH_BACK(first, last, nodes + idx);
+          while(first)
+          {
+              value_sum += first->value;
+              SLL_QUEUE_POP(first, last);
+          });
+    BENCH("DLL_PUSH_BACK+REMOVE", BENCH_INPUT_COUNT, 0.0,
+          BenchNode *first = 0;
+          BenchNode *last = 0;
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              DLL_PUSH_BACK(first, last, nodes + idx);
+          // NOTE(sokus): Remove every other node from the middle out first,
+          // then drain from the front.
+          for(int idx = 1; idx < BENCH_INPUT_COUNT; idx += 2)
+          {
+              BenchNode *node = nodes + idx;
+              DLL_REMOVE(first, last, node);
+          }
+          while(first)
+          {
+              value_sum += first->value;
+              BenchNode *node = first;
+              DLL_REMOVE(first, last, node);
+          });
+
+    static uint8_t pool_buffer[BENCH_INPUT_COUNT * (sizeof(mat4) + sizeof(uint32_t)) + 64];
+    MemoryArena pool_arena;
+    InitializeArena(&pool_arena, pool_buffer, sizeof(pool_buffer));
+    MemoryPool pool;
+    POOL_INIT(&pool, &pool_arena, mat4, BENCH_INPUT_COUNT);
+    static PoolHandle handles[BENCH_INPUT_COUNT];
+
+    BENCH("PoolAlloc+PoolFree", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              handles[idx] = PoolAlloc(&pool);
+          // NOTE(sokus): Free in a scrambled order so the free list doesn't
+          // just hand the slots back in address order.
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              PoolFree(&pool, handles[(idx * 1031) % BENCH_INPUT_COUNT]););
+    for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+        handles[idx] = PoolAlloc(&pool);
+    BENCH("PoolGet", BENCH_INPUT_COUNT, 0.0,
+          for(int idx = 0; idx < BENCH_INPUT_COUNT; ++idx)
+              value_sum += (POOL_GET(&pool, mat4, handles[idx]) != 0););
+
+    bench_sink += (float)(pointer_sum & 0xff) + (float)value_sum;
+}
+
+int main(int argument_count, char **arguments)
+{
+    bool csv = (argument_count > 1 && strcmp(arguments[1], "--csv") == 0);
+    srand(1);
+
+    if(csv)
+        printf("group,name,ns_per_op,mops_per_second,max_error\n");
+
+    Bench_FastMath();
+    Bench_Math();
+    Bench_Affine();
+    Bench_BatchTransforms();
+    Bench_Helpers();
+
+    char *previous_group = 0;
+    for(int result_idx = 0; result_idx < bench_result_count; ++result_idx)
+    {
+        BenchResult *result = bench_results + result_idx;
+        if(csv)
+        {
+            printf("%s,%s,%.4f,%.2f,%g\n", result->group, result->name,
+                   result->ns_per_op, result->mops_per_second, result->max_error);
+        }
+        else
+        {
+            if(result->group != previous_group)
+            {
+                printf("== %s ==\n", result->group);
+                previous_group = result->group;
+            }
+            printf("%-28s %10.3f ns/op %10.1f Mop/s", result->name,
+                   result->ns_per_op, result->mops_per_second);
+            if(result->max_error > 0.0)
+                printf("   max error %.3g", result->max_error);
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
@@ -1,12 +1,14 @@
 typedef struct Camera
 {
     vec3 pos;
+    quat orientation;
     vec3 front;
     vec3 up;
     vec3 right;
     vec3 world_up;
     
-    float yaw;
+    // NOTE(sokus): Only kept to clamp the pitch, the rotation itself
+    // lives in the orientation.
     float pitch;
     
     float sensitivity;
@@ -15,17 +17,12 @@ typedef struct Camera
 
 void UpdateCameraVectors(Camera *camera)
 {
-    float yaw_rad = ToRadians(camera->yaw);
-    float pitch_rad = ToRadians(camera->pitch);
-    
-    vec3 front;
-    front.x = CosF(yaw_rad) * CosF(pitch_rad);
-    front.y = SinF(pitch_rad);
-    front.z = SinF(yaw_rad) * CosF(pitch_rad);
-    camera->front = NormalizeVec3(front);
-    
-    camera->right = NormalizeVec3(Cross(camera->front, camera->world_up));
-    camera->up = NormalizeVec3(Cross(camera->right, camera->front));
+    // NOTE(sokus): Columns of a unit quaternion rotation are already
+    // orthonormal, no normalization needed. The camera looks down -Z.
+    mat3 rotation = Mat3FromQuat(camera->orientation);
+    camera->right = rotation.columns[0];
+    camera->up = rotation.columns[1];
+    camera->front = MultiplyVec3f(rotation.columns[2], -1.0f);
 }
 
 void InitializeCamera(Camera *camera,
@@ -36,7 +33,10 @@ void InitializeCamera(Camera *camera,
     camera->pos = Vec3(pos_x, pos_y, pos_z);
     camera->world_up = Vec3(0.0f, 1.0f, 0.0f);
     
-    camera->yaw = yaw;
+    // NOTE(sokus): Yaw of -90 degrees looks down -Z.
+    quat yaw_rotation = QuatFromAxisAngle(-(yaw + 90.0f), camera->world_up);
+    quat pitch_rotation = QuatFromAxisAngle(pitch, Vec3(1.0f, 0.0f, 0.0f));
+    camera->orientation = MultiplyQuat(yaw_rotation, pitch_rotation);
     camera->pitch = pitch;
     
     camera->sensitivity = sensitivity;
@@ -65,12 +65,118 @@ void ProcessMouse(Camera *camera, float relative_x, float relative_y)
     float scaled_relative_x = relative_x * camera->sensitivity;
     float scaled_relative_y = -relative_y * camera->sensitivity;
     
-    camera->yaw += scaled_relative_x;
-    camera->pitch = CLAMP(-89.0f, camera->pitch + scaled_relative_y, 89.0f);
+    float new_pitch = CLAMP(-89.0f, camera->pitch + scaled_relative_y, 89.0f);
+    float pitch_delta = new_pitch - camera->pitch;
+    camera->pitch = new_pitch;
+    
+    if(scaled_relative_x == 0.0f && pitch_delta == 0.0f)
+        return;
+    
+    // NOTE(sokus): Yaw around the world up axis (multiplied on the left),
+    // pitch around the camera's own right axis (on the right). Both axes are
+    // unit and axis aligned, so the quaternion products are written out
+    // without their zero terms, and an axis that didn't move costs nothing.
+    // This runs once per simulation step on the mouse motion accumulated
+    // since the last one.
+    quat q = camera->orientation;
+    if(scaled_relative_x != 0.0f)
+    {
+        float sin_half, cos_half;
+        SinCosF(-0.5f * ToRadians(scaled_relative_x), &sin_half, &cos_half);
+        q = Quat(cos_half * q.x + sin_half * q.z, cos_half * q.y + sin_half * q.w,
+                 cos_half * q.z - sin_half * q.x, cos_half * q.w - sin_half * q.y);
+    }
+    if(pitch_delta != 0.0f)
+    {
+        float sin_half, cos_half;
+        SinCosF(0.5f * ToRadians(pitch_delta), &sin_half, &cos_half);
+        q = Quat(cos_half * q.x + sin_half * q.w, cos_half * q.y + sin_half * q.z,
+                 cos_half * q.z - sin_half * q.y, cos_half * q.w - sin_half * q.x);
+    }
+    camera->orientation = NormalizeQuat(q);
     
     UpdateCameraVectors(camera);
 }
 
+// NOTE(sokus): The camera the renderer sees, t of the way from previous to
+// current simulation state. Only position and orientation move, the rest
+// comes from current.
+Camera InterpolateCamera(Camera *previous, float t, Camera *current)
+{
+    Camera result = *current;
+    result.pos = LerpVec3(previous->pos, t, current->pos);
+    result.orientation = NLerp(previous->orientation, t, current->orientation);
+    UpdateCameraVectors(&result);
+    return result;
+}
+
+// A floor of small cubes slowly spinning in place, this is mostly here
+// to have a few thousand entities going through the batch renderer.
+typedef struct CubeField
+{
+    TransformArrays transforms;
+    float *phases;
+    int count;
+    int count_x; // cubes are stored row by row
+    int count_z;
+} CubeField;
+
+void InitializeCubeField(CubeField *field, MemoryArena *arena,
+                         int count_x, int count_z, float spacing, float height)
+{
+    int count = count_x * count_z;
+    size_t array_count = (size_t)count;
+    field->count = count;
+    field->count_x = count_x;
+    field->count_z = count_z;
+    field->phases = PUSH_ARRAY(arena, float, array_count);
+    
+    TransformArrays *transforms = &field->transforms;
+    transforms->position_x = PUSH_ARRAY(arena, float, array_count);
+    transforms->position_y = PUSH_ARRAY(arena, float, array_count);
+    transforms->position_z = PUSH_ARRAY(arena, float, array_count);
+    transforms->rotation_x = PUSH_ARRAY(arena, float, array_count);
+    transforms->rotation_y = PUSH_ARRAY(arena, float, array_count);
+    transforms->rotation_z = PUSH_ARRAY(arena, float, array_count);
+    transforms->rotation_w = PUSH_ARRAY(arena, float, array_count);
+    transforms->scale_x = PUSH_ARRAY(arena, float, array_count);
+    transforms->scale_y = PUSH_ARRAY(arena, float, array_count);
+    transforms->scale_z = PUSH_ARRAY(arena, float, array_count);
+    
+    float offset_x = 0.5f * spacing * (float)(count_x - 1);
+    float offset_z = 0.5f * spacing * (float)(count_z - 1);
+    for(int z_idx = 0; z_idx < count_z; ++z_idx)
+    {
+        for(int x_idx = 0; x_idx < count_x; ++x_idx)
+        {
+            int idx = z_idx * count_x + x_idx;
+            transforms->position_x[idx] = (float)x_idx * spacing - offset_x;
+            transforms->position_y[idx] = height;
+            transforms->position_z[idx] = (float)z_idx * spacing - offset_z;
+            transforms->rotation_x[idx] = 0.0f;
+            transforms->rotation_y[idx] = 0.0f;
+            transforms->rotation_z[idx] = 0.0f;
+            transforms->rotation_w[idx] = 1.0f;
+            transforms->scale_x[idx] = 0.4f * spacing;
+            transforms->scale_y[idx] = 0.4f * spacing;
+            transforms->scale_z[idx] = 0.4f * spacing;
+            field->phases[idx] = 0.37f * (float)(x_idx + z_idx);
+        }
+    }
+}
+
+// NOTE(sokus): Updates the cubes in [first, first + count), so the field
+// can be split up between threads.
+void UpdateCubeField(CubeField *field, int first, int count, float time)
+{
+    TransformArrays *transforms = &field->transforms;
+    for(int idx = first; idx < first + count; ++idx)
+    {
+        float half_angle = 0.5f * (time + field->phases[idx]);
+        SinCosF(half_angle, &transforms->rotation_y[idx], &transforms->rotation_w[idx]);
+    }
+}
+
 void InitializeInput(Input *input)
 {
     MEMORY_SET(&input->keys_down_duration, -1.0f, sizeof(input->keys_down_duration));
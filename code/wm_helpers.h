@@ -8,6 +8,23 @@
 #include <stdbool.h> // bool
 #include <stdint.h>  // int8_t, uint32_t
 #include <stddef.h>  // size_t
+#include <stdatomic.h> // SharedArena
+
+// NOTE(sokus): Set to 1 to have every arena count its pushes, see DumpArenaStats.
+#ifndef WM_ARENA_STATS
+#define WM_ARENA_STATS 0
+#endif
+
+#if WM_ARENA_STATS
+#include <stdio.h> // DumpArenaStats
+#endif
+
+#if defined(__linux__)
+#include <sys/mman.h> // mmap, mprotect, madvise
+#define WM_VIRTUAL_MEMORY 1
+#else
+#define WM_VIRTUAL_MEMORY 0
+#endif
 
 // keywords
 #define internal static
@@ -50,27 +67,160 @@
 
 //~NOTE(sokus): memory arenas
 
+// NOTE(sokus): Bucket n counts pushes of [2^(n-1), 2^n) bytes, bucket 0 counts
+// empty pushes and the last one everything bigger.
+#define ARENA_HISTOGRAM_BUCKETS 32
+
+typedef struct ArenaStats
+{
+    size_t peak_used;
+    uint64_t push_count;
+    uint64_t push_bytes;
+    uint64_t failed_push_count;
+    uint64_t push_size_histogram[ARENA_HISTOGRAM_BUCKETS];
+} ArenaStats;
+
+// NOTE(sokus): An arena is either a fixed buffer handed to InitializeArena,
+// or a growable one that reserves address space up front and commits pages
+// as used grows (InitializeGrowableArena, Linux only for now).
 typedef struct MemoryArena
 {
     uint8_t *base;
-    size_t size;
+    size_t size;      // reserved size for growable arenas
     size_t used;
+    size_t committed; // always equal to size for fixed arenas
+    size_t decommit_threshold;
+    bool growable;
+    int temporary_count;
+    char *tag;
+#if WM_ARENA_STATS
+    ArenaStats stats;
+#endif
 } MemoryArena;
 
+#define ARENA_COMMIT_GRANULARITY KILOBYTES(64)
+
 void InitializeArena(MemoryArena *arena, uint8_t *base, size_t size)
 {
     arena->base = base;
     arena->size = size;
     arena->used = 0;
+    arena->committed = size;
+    arena->decommit_threshold = size;
+    arena->growable = false;
+    arena->temporary_count = 0;
+    arena->tag = 0;
+#if WM_ARENA_STATS
+    MEMORY_SET(&arena->stats, 0, sizeof(arena->stats));
+#endif
+}
+
+size_t AlignUpPow2(size_t value, size_t alignment)
+{
+    ASSERT((alignment & (alignment - 1)) == 0);
+    size_t result = (value + alignment - 1) & ~(alignment - 1);
+    return result;
+}
+
+#if WM_VIRTUAL_MEMORY
+// NOTE(sokus): Nothing is committed here, pages past the decommit threshold
+// are handed back to the OS every time the arena gets cleared.
+bool InitializeGrowableArena(MemoryArena *arena, size_t reserve_size, size_t decommit_threshold)
+{
+    bool result = false;
+    reserve_size = AlignUpPow2(reserve_size, ARENA_COMMIT_GRANULARITY);
+    void *base = mmap(0, reserve_size, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(base != MAP_FAILED)
+    {
+        arena->base = (uint8_t *)base;
+        arena->size = reserve_size;
+        arena->used = 0;
+        arena->committed = 0;
+        arena->decommit_threshold = MIN(AlignUpPow2(decommit_threshold, ARENA_COMMIT_GRANULARITY), reserve_size);
+        arena->growable = true;
+        arena->temporary_count = 0;
+        arena->tag = 0;
+#if WM_ARENA_STATS
+        MEMORY_SET(&arena->stats, 0, sizeof(arena->stats));
+#endif
+        result = true;
+    }
+    return result;
+}
+
+void ReleaseArena(MemoryArena *arena)
+{
+    if(arena->growable && arena->base)
+        munmap(arena->base, arena->size);
+    arena->base = 0;
+    arena->size = 0;
+    arena->used = 0;
+    arena->committed = 0;
+}
+
+bool MemoryArenaCommit(MemoryArena *arena, size_t min_committed)
+{
+    bool result = true;
+    if(min_committed > arena->committed)
+    {
+        size_t new_committed = MIN(AlignUpPow2(min_committed, ARENA_COMMIT_GRANULARITY), arena->size);
+        uint8_t *commit_base = arena->base + arena->committed;
+        result = (mprotect(commit_base, new_committed - arena->committed, PROT_READ | PROT_WRITE) == 0);
+        if(result)
+            arena->committed = new_committed;
+    }
+    return result;
+}
+
+void MemoryArenaDecommit(MemoryArena *arena, size_t max_committed)
+{
+    if(max_committed < arena->committed)
+    {
+        uint8_t *decommit_base = arena->base + max_committed;
+        size_t decommit_size = arena->committed - max_committed;
+        madvise(decommit_base, decommit_size, MADV_DONTNEED);
+        mprotect(decommit_base, decommit_size, PROT_NONE);
+        arena->committed = max_committed;
+    }
+}
+#else
+bool MemoryArenaCommit(MemoryArena *arena, size_t min_committed)
+{
+    bool result = (min_committed <= arena->committed);
+    return result;
+}
+
+void MemoryArenaDecommit(MemoryArena *arena, size_t max_committed)
+{
+    (void)arena;
+    (void)max_committed;
 }
+#endif
 
 void ClearArena(MemoryArena *arena)
 {
+    ASSERT(arena->temporary_count == 0);
     arena->used = 0;
+    if(arena->growable && arena->committed > arena->decommit_threshold)
+        MemoryArenaDecommit(arena, arena->decommit_threshold);
 }
 
-#define PUSH_STRUCT(arena, type) (type *)MemoryArenaPushSize(arena, sizeof(type))
-#define PUSH_ARRAY(arena, type, count) (type *)MemoryArenaPushSize(arena, (count)*sizeof(type)) 
+#define ARENA_DEFAULT_ALIGNMENT 16
+
+#define PUSH_STRUCT(arena, type) (type *)MemoryArenaPushSizeAligned(arena, sizeof(type), _Alignof(type))
+#define PUSH_ARRAY(arena, type, count) (type *)MemoryArenaPushSizeAligned(arena, (count)*sizeof(type), _Alignof(type))
+#define PUSH_SIZE(arena, size) MemoryArenaPushSizeAligned(arena, size, ARENA_DEFAULT_ALIGNMENT)
+
+// NOTE(sokus): Padding needed to move the next push up to the alignment.
+// Alignment is relative to the actual address, not to used, since the
+// base of a fixed arena can be anything.
+size_t MemoryArenaAlignmentOffset(MemoryArena *arena, size_t alignment)
+{
+    uintptr_t next = (uintptr_t)(arena->base + arena->used);
+    size_t result = AlignUpPow2(next, alignment) - next;
+    return result;
+}
 
 bool MemoryArenaCanFit(MemoryArena *arena, size_t size)
 {
@@ -78,16 +228,91 @@ bool MemoryArenaCanFit(MemoryArena *arena, size_t size)
     return result;
 }
 
+bool MemoryArenaCanFitAligned(MemoryArena *arena, size_t size, size_t alignment)
+{
+    size_t offset = MemoryArenaAlignmentOffset(arena, alignment);
+    bool result = MemoryArenaCanFit(arena, offset + size);
+    return result;
+}
+
+#if WM_ARENA_STATS
+int ArenaHistogramBucket(size_t size)
+{
+    int result = 0;
+    while(size && result < ARENA_HISTOGRAM_BUCKETS - 1)
+    {
+        size >>= 1;
+        ++result;
+    }
+    return result;
+}
+
+void RecordArenaPush(MemoryArena *arena, size_t size, bool succeeded)
+{
+    ArenaStats *stats = &arena->stats;
+    if(succeeded)
+    {
+        ++stats->push_count;
+        stats->push_bytes += size;
+        ++stats->push_size_histogram[ArenaHistogramBucket(size)];
+        stats->peak_used = MAX(stats->peak_used, arena->used);
+    }
+    else
+    {
+        ++stats->failed_push_count;
+    }
+}
+
+void DumpArenaStats(MemoryArena *arena, FILE *stream)
+{
+    ArenaStats *stats = &arena->stats;
+    fprintf(stream, "arena %s: used %zu peak %zu committed %zu size %zu\n",
+            arena->tag ? arena->tag : "(untagged)",
+            arena->used, stats->peak_used, arena->committed, arena->size);
+    fprintf(stream, "  pushes %llu bytes %llu failed %llu\n",
+            (unsigned long long)stats->push_count,
+            (unsigned long long)stats->push_bytes,
+            (unsigned long long)stats->failed_push_count);
+    for(int bucket_idx = 0; bucket_idx < ARENA_HISTOGRAM_BUCKETS; ++bucket_idx)
+    {
+        uint64_t bucket_count = stats->push_size_histogram[bucket_idx];
+        if(bucket_count)
+        {
+            size_t bucket_min = bucket_idx ? ((size_t)1 << (bucket_idx - 1)) : 0;
+            fprintf(stream, "  >= %zu bytes: %llu\n", bucket_min, (unsigned long long)bucket_count);
+        }
+    }
+}
+#else
+#define RecordArenaPush(arena, size, succeeded)
+#endif
+
 void *MemoryArenaPushSize(MemoryArena *arena, size_t size)
 {
     void *result = 0;
     bool can_fit = MemoryArenaCanFit(arena, size);
-    ASSERT(can_fit);
     if(can_fit)
     {
-        result = arena->base + arena->used;
-        arena->used += size;
+        size_t new_used = arena->used + size;
+        bool committed = (new_used <= arena->committed || MemoryArenaCommit(arena, new_used));
+        if(committed)
+        {
+            result = arena->base + arena->used;
+            arena->used = new_used;
+        }
     }
+    RecordArenaPush(arena, size, result != 0);
+    ASSERT(result);
+    return result;
+}
+
+void *MemoryArenaPushSizeAligned(MemoryArena *arena, size_t size, size_t alignment)
+{
+    void *result = 0;
+    size_t offset = MemoryArenaAlignmentOffset(arena, alignment);
+    uint8_t *bytes = (uint8_t *)MemoryArenaPushSize(arena, offset + size);
+    if(bytes)
+        result = bytes + offset;
     return result;
 }
 
@@ -101,6 +326,130 @@ void *MemoryArenaPopSize(MemoryArena *arena, size_t size)
     return result;
 }
 
+// NOTE(sokus): A savepoint in an arena, everything pushed after Begin gets
+// freed by End, without the caller having to remember the sizes.
+typedef struct TemporaryMemory
+{
+    MemoryArena *arena;
+    size_t used;
+} TemporaryMemory;
+
+TemporaryMemory BeginTemporaryMemory(MemoryArena *arena)
+{
+    TemporaryMemory result;
+    result.arena = arena;
+    result.used = arena->used;
+    ++arena->temporary_count;
+    return result;
+}
+
+void EndTemporaryMemory(TemporaryMemory temporary_memory)
+{
+    MemoryArena *arena = temporary_memory.arena;
+    ASSERT(arena->used >= temporary_memory.used);
+    ASSERT(arena->temporary_count > 0);
+    arena->used = temporary_memory.used;
+    --arena->temporary_count;
+}
+
+// NOTE(sokus): Two arenas that take turns, BeginScratchFrame clears the one
+// for the new frame so everything pushed last frame stays valid for one more.
+typedef struct ScratchArenas
+{
+    MemoryArena arenas[2];
+    uint32_t frame_index;
+} ScratchArenas;
+
+MemoryArena *BeginScratchFrame(ScratchArenas *scratch)
+{
+    ++scratch->frame_index;
+    MemoryArena *result = scratch->arenas + (scratch->frame_index & 1);
+    ClearArena(result);
+    return result;
+}
+
+MemoryArena *GetScratchArena(ScratchArenas *scratch)
+{
+    MemoryArena *result = scratch->arenas + (scratch->frame_index & 1);
+    return result;
+}
+
+
+//~NOTE(sokus): shared arenas
+
+// NOTE(sokus): A lock-free bump allocator several threads can push into at
+// once. Pushing for every small allocation makes the threads fight over
+// one cache line, so workers should carve out a per-thread MemoryArena
+// with SharedArenaCarveArena and push into that instead.
+typedef struct SharedArena
+{
+    uint8_t *base;
+    size_t size;
+    _Atomic size_t used;
+    char *tag;
+#if WM_ARENA_STATS
+    _Atomic uint64_t push_count;
+    _Atomic uint64_t failed_push_count;
+#endif
+} SharedArena;
+
+void InitializeSharedArena(SharedArena *arena, uint8_t *base, size_t size)
+{
+    arena->base = base;
+    arena->size = size;
+    atomic_init(&arena->used, 0);
+    arena->tag = 0;
+#if WM_ARENA_STATS
+    atomic_init(&arena->push_count, 0);
+    atomic_init(&arena->failed_push_count, 0);
+#endif
+}
+
+// NOTE(sokus): Not safe to call while other threads are still pushing.
+void ClearSharedArena(SharedArena *arena)
+{
+    atomic_store(&arena->used, 0);
+}
+
+void *SharedArenaPushSizeAligned(SharedArena *arena, size_t size, size_t alignment)
+{
+    void *result = 0;
+    size_t used = atomic_load_explicit(&arena->used, memory_order_relaxed);
+    for(;;)
+    {
+        uintptr_t next = (uintptr_t)(arena->base + used);
+        size_t offset = AlignUpPow2(next, alignment) - next;
+        size_t new_used = used + offset + size;
+        if(new_used > arena->size)
+            break;
+        if(atomic_compare_exchange_weak_explicit(&arena->used, &used, new_used,
+                                                 memory_order_relaxed, memory_order_relaxed))
+        {
+            result = arena->base + used + offset;
+            break;
+        }
+    }
+#if WM_ARENA_STATS
+    atomic_fetch_add_explicit(result ? &arena->push_count : &arena->failed_push_count,
+                              1, memory_order_relaxed);
+#endif
+    return result;
+}
+
+#define SHARED_PUSH_STRUCT(arena, type) (type *)SharedArenaPushSizeAligned(arena, sizeof(type), _Alignof(type))
+#define SHARED_PUSH_ARRAY(arena, type, count) (type *)SharedArenaPushSizeAligned(arena, (count)*sizeof(type), _Alignof(type))
+
+bool SharedArenaCarveArena(SharedArena *shared, MemoryArena *arena, size_t size, char *tag)
+{
+    uint8_t *base = (uint8_t *)SharedArenaPushSizeAligned(shared, size, ARENA_DEFAULT_ALIGNMENT);
+    bool result = (base != 0);
+    if(result)
+    {
+        InitializeArena(arena, base, size);
+        arena->tag = tag;
+    }
+    return result;
+}
 
 //~NOTE(sokus): Singly Linked Lists
 
@@ -123,9 +472,7 @@ void *MemoryArenaPopSize(MemoryArena *arena, size_t size)
 
 #define SLL_QUEUE_POP(f, l) SLL_QUEUE_POP_EXPLICIT(f, l, next)
 
-#define SLL_STACK_PUSH_EXPLICIT(f, n, next) ((f)==0?\
-((f)=(n)):\
-((n)->next=(f), (f)=(n)))
+#define SLL_STACK_PUSH_EXPLICIT(f, n, next) ((n)->next=(f), (f)=(n))
 
 #define SLL_STACK_PUSH(f, n) SLL_STACK_PUSH_EXPLICIT(f, n, next)
 
@@ -155,6 +502,132 @@ void *MemoryArenaPopSize(MemoryArena *arena, size_t size)
 
 
 
+//~NOTE(sokus): pools
+
+// NOTE(sokus): Fixed size slots carved out of an arena. Free slots form an
+// intrusive stack, so alloc and free are O(1). Every slot has a generation
+// that gets bumped on free, a handle only resolves while its generation
+// matches, so stale handles come back as 0 instead of aliasing a new object.
+// Generation 0 is never handed out, a zeroed PoolHandle is always invalid.
+
+typedef struct PoolHandle
+{
+    uint32_t index;
+    uint32_t generation;
+} PoolHandle;
+
+typedef struct PoolFreeSlot
+{
+    struct PoolFreeSlot *next;
+} PoolFreeSlot;
+
+typedef struct MemoryPool
+{
+    uint8_t *slots;
+    uint32_t *generations;
+    PoolFreeSlot *free_list;
+    size_t slot_size;
+    uint32_t capacity;
+    uint32_t slots_touched; // slots past this were never handed out
+    
+    uint32_t count;
+    uint32_t peak_count;
+    uint64_t alloc_count;
+    uint64_t free_count;
+    uint64_t failed_alloc_count;
+} MemoryPool;
+
+#define POOL_INIT(pool, arena, type, capacity) InitializePool(pool, arena, sizeof(type), _Alignof(type), capacity)
+#define POOL_GET(pool, type, handle) ((type *)PoolGet(pool, handle))
+
+bool InitializePool(MemoryPool *pool, MemoryArena *arena,
+                    size_t slot_size, size_t slot_alignment, uint32_t capacity)
+{
+    MEMORY_SET(pool, 0, sizeof(*pool));
+    slot_alignment = MAX(slot_alignment, _Alignof(PoolFreeSlot));
+    pool->slot_size = AlignUpPow2(MAX(slot_size, sizeof(PoolFreeSlot)), slot_alignment);
+    pool->slots = (uint8_t *)MemoryArenaPushSizeAligned(arena, pool->slot_size * capacity, slot_alignment);
+    pool->generations = PUSH_ARRAY(arena, uint32_t, capacity);
+    bool result = (pool->slots && pool->generations);
+    if(result)
+    {
+        pool->capacity = capacity;
+        for(uint32_t slot_idx = 0; slot_idx < capacity; ++slot_idx)
+            pool->generations[slot_idx] = 1;
+    }
+    return result;
+}
+
+bool PoolHandleIsValid(MemoryPool *pool, PoolHandle handle)
+{
+    bool result = (handle.index < pool->slots_touched &&
+                   handle.generation != 0 &&
+                   pool->generations[handle.index] == handle.generation);
+    return result;
+}
+
+void *PoolGet(MemoryPool *pool, PoolHandle handle)
+{
+    void *result = 0;
+    if(PoolHandleIsValid(pool, handle))
+        result = pool->slots + handle.index * pool->slot_size;
+    return result;
+}
+
+// NOTE(sokus): Slots come back zeroed, returns a zero handle when full.
+PoolHandle PoolAlloc(MemoryPool *pool)
+{
+    PoolHandle result = {0};
+    uint8_t *slot = 0;
+    if(pool->free_list)
+    {
+        slot = (uint8_t *)pool->free_list;
+        SLL_STACK_POP(pool->free_list);
+    }
+    else if(pool->slots_touched < pool->capacity)
+    {
+        slot = pool->slots + pool->slots_touched * pool->slot_size;
+        ++pool->slots_touched;
+    }
+    
+    if(slot)
+    {
+        MEMORY_SET(slot, 0, pool->slot_size);
+        result.index = (uint32_t)((size_t)(slot - pool->slots) / pool->slot_size);
+        result.generation = pool->generations[result.index];
+        ++pool->count;
+        ++pool->alloc_count;
+        pool->peak_count = MAX(pool->peak_count, pool->count);
+    }
+    else
+    {
+        ++pool->failed_alloc_count;
+    }
+    return result;
+}
+
+bool PoolFree(MemoryPool *pool, PoolHandle handle)
+{
+    bool result = PoolHandleIsValid(pool, handle);
+    ASSERT(result);
+    if(result)
+    {
+        uint32_t next_generation = handle.generation + 1;
+        pool->generations[handle.index] = (next_generation != 0) ? next_generation : 1;
+        PoolFreeSlot *slot = (PoolFreeSlot *)(pool->slots + handle.index * pool->slot_size);
+        SLL_STACK_PUSH(pool->free_list, slot);
+        --pool->count;
+        ++pool->free_count;
+    }
+    return result;
+}
+
+float PoolOccupancy(MemoryPool *pool)
+{
+    float result = pool->capacity ? (float)pool->count / (float)pool->capacity : 0.0f;
+    return result;
+}
+
 //~NOTE(sokus): string
 
 void ConcatenateStrings(char *str_a, size_t str_a_size,
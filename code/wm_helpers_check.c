@@ -0,0 +1,118 @@
+// Checks the MemoryPool handles of wm_helpers.h: slot reuse, stale handles
+// and running out of slots. Built and run by build.sh as
+// white-mage-helpers-check.out, exits with 1 when any of them fails.
+
+#include "wm_helpers.h"
+#include "wm_math.h"
+
+#include <stdio.h>
+
+#define CHECK_POOL_CAPACITY 64
+
+bool Check(char *name, bool passed)
+{
+    printf("%-44s %s\n", name, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+bool Check_SlotIsZero(mat4 *slot)
+{
+    bool result = true;
+    for(int col_idx = 0; col_idx < 4; ++col_idx)
+        for(int row_idx = 0; row_idx < 4; ++row_idx)
+            result = result && (slot->elements[col_idx][row_idx] == 0.0f);
+    return result;
+}
+
+int main(void)
+{
+    static uint8_t pool_memory[KILOBYTES(16)];
+    MemoryArena pool_arena;
+    InitializeArena(&pool_arena, pool_memory, sizeof(pool_memory));
+
+    MemoryPool pool;
+    bool result = Check("POOL_INIT", POOL_INIT(&pool, &pool_arena, mat4, CHECK_POOL_CAPACITY));
+
+    PoolHandle zero_handle = {0};
+    result &= Check("zeroed handle is invalid", !PoolHandleIsValid(&pool, zero_handle) &&
+                    POOL_GET(&pool, mat4, zero_handle) == 0);
+
+    // NOTE(sokus): Fill the pool, every slot comes back zeroed, aligned and
+    // distinct. The value written is checked again after the frees below.
+    static PoolHandle handles[CHECK_POOL_CAPACITY];
+    bool all_valid = true;
+    bool all_zeroed = true;
+    bool all_aligned = true;
+    bool all_distinct = true;
+    for(int handle_idx = 0; handle_idx < CHECK_POOL_CAPACITY; ++handle_idx)
+    {
+        handles[handle_idx] = PoolAlloc(&pool);
+        mat4 *slot = POOL_GET(&pool, mat4, handles[handle_idx]);
+        all_valid = all_valid && slot;
+        if(slot)
+        {
+            all_zeroed = all_zeroed && Check_SlotIsZero(slot);
+            all_aligned = all_aligned && ((uintptr_t)slot % _Alignof(mat4) == 0);
+            *slot = Mat4d((float)handle_idx);
+        }
+        for(int other_idx = 0; other_idx < handle_idx; ++other_idx)
+            all_distinct = all_distinct && (handles[other_idx].index != handles[handle_idx].index);
+    }
+    result &= Check("alloc up to capacity", all_valid && pool.count == CHECK_POOL_CAPACITY);
+    result &= Check("slots come back zeroed and aligned", all_zeroed && all_aligned);
+    result &= Check("slots are distinct", all_distinct);
+
+    PoolHandle overflow = PoolAlloc(&pool);
+    result &= Check("alloc past capacity fails", overflow.generation == 0 &&
+                    !PoolHandleIsValid(&pool, overflow) &&
+                    pool.failed_alloc_count == 1 && pool.count == CHECK_POOL_CAPACITY);
+
+    // NOTE(sokus): A freed slot is handed out again under a new generation,
+    // the old handle must not resolve to the new object.
+    PoolHandle freed = handles[17];
+    result &= Check("free", PoolFree(&pool, freed) && pool.count == CHECK_POOL_CAPACITY - 1);
+    result &= Check("freed handle is rejected", !PoolHandleIsValid(&pool, freed) &&
+                    POOL_GET(&pool, mat4, freed) == 0);
+
+    PoolHandle reused = PoolAlloc(&pool);
+    mat4 *reused_slot = POOL_GET(&pool, mat4, reused);
+    result &= Check("freed slot is reused", reused.index == freed.index &&
+                    reused.generation != freed.generation &&
+                    reused_slot && Check_SlotIsZero(reused_slot));
+    result &= Check("stale handle stays rejected after reuse", !PoolHandleIsValid(&pool, freed) &&
+                    POOL_GET(&pool, mat4, freed) == 0);
+    handles[17] = reused;
+    *reused_slot = Mat4d(17.0f);
+
+    bool others_intact = true;
+    for(int handle_idx = 0; handle_idx < CHECK_POOL_CAPACITY; ++handle_idx)
+    {
+        mat4 *slot = POOL_GET(&pool, mat4, handles[handle_idx]);
+        others_intact = others_intact && slot && slot->elements[0][0] == (float)handle_idx;
+    }
+    result &= Check("other slots untouched by free and reuse", others_intact);
+
+    // NOTE(sokus): Emptying and refilling invalidates every old handle.
+    for(int handle_idx = 0; handle_idx < CHECK_POOL_CAPACITY; ++handle_idx)
+        PoolFree(&pool, handles[handle_idx]);
+    bool all_rejected = (pool.count == 0);
+    for(int handle_idx = 0; handle_idx < CHECK_POOL_CAPACITY; ++handle_idx)
+    {
+        PoolHandle handle = PoolAlloc(&pool);
+        all_rejected = all_rejected && PoolHandleIsValid(&pool, handle) &&
+            !PoolHandleIsValid(&pool, handles[handle_idx]);
+        handles[handle_idx] = handle;
+    }
+    result &= Check("refill rejects every old handle", all_rejected && pool.count == CHECK_POOL_CAPACITY);
+
+    // NOTE(sokus): Generations wrap around to 1, 0 is reserved for invalid.
+    PoolHandle wrapping = handles[0];
+    pool.generations[wrapping.index] = UINT32_MAX;
+    wrapping.generation = UINT32_MAX;
+    PoolFree(&pool, wrapping);
+    PoolHandle wrapped = PoolAlloc(&pool);
+    result &= Check("generation wraps around to 1", wrapped.index == wrapping.index && wrapped.generation == 1 &&
+                    !PoolHandleIsValid(&pool, wrapping));
+
+    return result ? 0 : 1;
+}
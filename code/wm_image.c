@@ -0,0 +1,119 @@
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+typedef struct Image
+{
+    uint8_t *data;
+    int width;
+    int height;
+    int channels;
+} Image;
+
+Image LoadImageEx(char *path, int opt_force_channels)
+{
+    Image result = {0};
+    
+    int width, height, channels, src_channels = 0;
+    uint8_t *data = stbi_load(path, &width, &height, &src_channels, opt_force_channels);
+    
+    if(data)
+    {
+        channels = (opt_force_channels != 0 ? opt_force_channels : src_channels);
+        result.data = data;
+        result.width = width;
+        result.height = height;
+        result.channels = channels;
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Could not load texture: %s\n", path);
+    }
+    
+    return result;
+}
+
+void UnloadImage(Image *image)
+{
+    stbi_image_free(image->data);
+    MEMORY_SET(image, 0, sizeof(Image));
+}
+
+// NOTE(sokus): Tile rows are short (48 bytes for a 16x16 RGB tile), a call
+// to memcpy per row costs more than the copy itself.
+void CopyTileRow(uint8_t *destination, uint8_t *source, size_t size)
+{
+    size_t byte_idx = 0;
+#if defined(__SSE2__)
+    for(; byte_idx + 16 <= size; byte_idx += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((__m128i *)(source + byte_idx));
+        _mm_storeu_si128((__m128i *)(destination + byte_idx), bytes);
+    }
+#endif
+    for(; byte_idx < size; ++byte_idx)
+        destination[byte_idx] = source[byte_idx];
+}
+
+// NOTE(sokus): Cuts an atlas into tiles laid out one after another, tile
+// (x, y) becomes layer y * tile_count_x + x, with the rows of every tile
+// flipped since GL wants the bottom row first. Returns false when the
+// image doesn't split evenly into tiles.
+//
+// The destination gets written strictly in order, that matters more than
+// the order of the reads since scattered writes have to pull every line in
+// before overwriting it.
+bool SliceImageTiles(Image *image, int tile_width, int tile_height, uint8_t *destination)
+{
+    bool result = (tile_width > 0 && tile_height > 0 &&
+                   image->width % tile_width == 0 &&
+                   image->height % tile_height == 0);
+    if(result)
+    {
+        int tiles_x = image->width / tile_width;
+        int tiles_y = image->height / tile_height;
+        size_t tile_row_size = (size_t)(tile_width * image->channels);
+        size_t image_row_size = tile_row_size * (size_t)tiles_x;
+        uint8_t *row = destination;
+        for(int tile_y_idx = 0; tile_y_idx < tiles_y; ++tile_y_idx)
+        {
+            // NOTE(sokus): Last row of the tile band, tiles are stored flipped.
+            uint8_t *band_bottom = image->data + ((size_t)((tile_y_idx + 1) * tile_height - 1) * image_row_size);
+            for(int tile_x_idx = 0; tile_x_idx < tiles_x; ++tile_x_idx)
+            {
+                uint8_t *source = band_bottom + (size_t)tile_x_idx * tile_row_size;
+                for(int tile_pixel_y = 0; tile_pixel_y < tile_height; ++tile_pixel_y)
+                {
+                    CopyTileRow(row, source, tile_row_size);
+                    row += tile_row_size;
+                    source -= image_row_size;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// NOTE(sokus): Next mip level with a 2x2 box filter. Sizes halve rounding
+// down like GL's level sizes, a side that's already 1 pixel stays 1.
+void HalveImagePixels(uint8_t *source, int width, int height, int channels, uint8_t *destination)
+{
+    int half_width = MAX(width / 2, 1);
+    int half_height = MAX(height / 2, 1);
+    for(int y = 0; y < half_height; ++y)
+    {
+        uint8_t *row0 = source + (size_t)(MIN(2 * y, height - 1) * width * channels);
+        uint8_t *row1 = source + (size_t)(MIN(2 * y + 1, height - 1) * width * channels);
+        for(int x = 0; x < half_width; ++x)
+        {
+            int x0 = MIN(2 * x, width - 1) * channels;
+            int x1 = MIN(2 * x + 1, width - 1) * channels;
+            for(int channel = 0; channel < channels; ++channel)
+            {
+                int sum = (row0[x0 + channel] + row0[x1 + channel] +
+                           row1[x0 + channel] + row1[x1 + channel]);
+                *destination++ = (uint8_t)((sum + 2) / 4);
+            }
+        }
+    }
+}
@@ -6,7 +6,17 @@
 typedef struct ReadFileResult
 {
     void *data;
-    uint32_t size;
+    size_t size;
 } ReadFileResult;
 
+// NOTE(sokus): A read-only view of a whole file. It is either mapped straight
+// from the page cache, or read into the fallback arena when mapping fails, in
+// which case the arena owns the memory. Either way Linux_UnmapFile ends the view.
+typedef struct MappedFile
+{
+    void *data;
+    size_t size;
+    bool is_mapped;
+} MappedFile;
+
 #endif //WM_LINUX_H
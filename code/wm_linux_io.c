@@ -0,0 +1,461 @@
+//~NOTE(sokus): files
+
+// NOTE(sokus): Reads the whole file into the arena. Keeps going on short
+// reads and EINTR, pops everything it pushed if the read fails.
+ReadFileResult Linux_ReadEntireFile(MemoryArena *arena, char *path, bool end_with_zero)
+{
+    ReadFileResult result = {0};
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        fprintf(stderr, "ERROR: Could not open file %s: %s\n", path, strerror(errno));
+        return result;
+    }
+    
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) == 0)
+    {
+        size_t file_size = (size_t)file_stat.st_size;
+        size_t size_needed = file_size + (end_with_zero ? 1 : 0);
+        size_t used_before = arena->used;
+        uint8_t *data = (uint8_t *)PUSH_SIZE(arena, size_needed ? size_needed : 1);
+        
+        size_t bytes_read = 0;
+        bool read_failed = (data == 0);
+        while(!read_failed && bytes_read < file_size)
+        {
+            ssize_t chunk = read(fd, data + bytes_read, file_size - bytes_read);
+            if(chunk > 0)
+                bytes_read += (size_t)chunk;
+            else if(chunk == 0)
+                break; // NOTE(sokus): File got truncated under us, keep what we have.
+            else if(errno != EINTR)
+                read_failed = true;
+        }
+        
+        if(read_failed)
+        {
+            fprintf(stderr, "ERROR: Could not read file %s: %s\n", path, strerror(errno));
+            arena->used = used_before;
+        }
+        else
+        {
+            if(end_with_zero)
+                data[bytes_read] = 0;
+            result.data = data;
+            result.size = bytes_read + (end_with_zero ? 1 : 0);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Could not stat file %s: %s\n", path, strerror(errno));
+    }
+    
+    close(fd);
+    return result;
+}
+
+MappedFile Linux_MapFile(char *path, MemoryArena *fallback_arena)
+{
+    MappedFile result = {0};
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        fprintf(stderr, "ERROR: Could not open file %s: %s\n", path, strerror(errno));
+        return result;
+    }
+    
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+    {
+        size_t size = (size_t)file_stat.st_size;
+        void *data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data != MAP_FAILED)
+        {
+            // NOTE(sokus): These are advice values, not flags, so two calls.
+            madvise(data, size, MADV_SEQUENTIAL);
+            madvise(data, size, MADV_WILLNEED);
+            result.data = data;
+            result.size = size;
+            result.is_mapped = true;
+        }
+    }
+    close(fd);
+    
+    if(!result.is_mapped && fallback_arena)
+    {
+        ReadFileResult file = Linux_ReadEntireFile(fallback_arena, path, false);
+        result.data = file.data;
+        result.size = file.size;
+    }
+    return result;
+}
+
+void Linux_UnmapFile(MappedFile *file)
+{
+    if(file->is_mapped)
+        munmap(file->data, file->size);
+    file->data = 0;
+    file->size = 0;
+    file->is_mapped = false;
+}
+
+
+//~NOTE(sokus): async asset loads
+
+// NOTE(sokus): The main thread submits loads, worker threads read or decode
+// them and hand them back through a completion ring the main loop drains
+// every frame. Workers never touch GL, uploads stay on the render thread.
+//
+// Results that need memory of their own (sliced tiles, files that can't be
+// mapped) go into their worker's arena. The worker arenas are carved out of one
+// SharedArena when the queue starts, and the main thread clears them
+// whenever nothing is in flight and every completed load was released.
+
+typedef enum AssetKind
+{
+    AssetKind_File,       // mapped read-only, see MappedFile
+    AssetKind_Image,      // decoded by stb_image
+    AssetKind_TiledImage, // decoded, then sliced with SliceImageTiles
+} AssetKind;
+
+typedef struct AssetLoad
+{
+    // NOTE(sokus): Filled in by the submitter.
+    AssetKind kind;
+    char *path; // has to stay valid until the load completes
+    uint32_t id;
+    int force_channels;
+    int tile_width;
+    int tile_height;
+    
+    // NOTE(sokus): Filled in by the worker. For tiled images image.data
+    // holds the tiles in upload order instead of the decoded rows.
+    bool succeeded;
+    MappedFile file;
+    Image image;
+    
+    bool popped; // handed to the main thread and not released yet
+} AssetLoad;
+
+// NOTE(sokus): Bounded MPMC ring (Dmitry Vyukov's). Every cell carries a
+// sequence number telling producers and consumers whose turn it is, so
+// push and pop are a single CAS on the position in the common case.
+typedef struct AssetRingCell
+{
+    _Atomic size_t sequence;
+    AssetLoad load;
+} AssetRingCell;
+
+typedef struct AssetRing
+{
+    AssetRingCell *cells;
+    size_t mask;
+    _Alignas(64) _Atomic size_t enqueue_position;
+    _Alignas(64) _Atomic size_t dequeue_position;
+} AssetRing;
+
+void InitializeAssetRing(AssetRing *ring, MemoryArena *arena, size_t capacity)
+{
+    ASSERT(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+    ring->cells = PUSH_ARRAY(arena, AssetRingCell, capacity);
+    ring->mask = capacity - 1;
+    for(size_t cell_idx = 0; cell_idx < capacity; ++cell_idx)
+        atomic_init(&ring->cells[cell_idx].sequence, cell_idx);
+    atomic_init(&ring->enqueue_position, 0);
+    atomic_init(&ring->dequeue_position, 0);
+}
+
+bool AssetRingPush(AssetRing *ring, AssetLoad *load)
+{
+    bool result = false;
+    AssetRingCell *cell = 0;
+    size_t position = atomic_load_explicit(&ring->enqueue_position, memory_order_relaxed);
+    for(;;)
+    {
+        cell = ring->cells + (position & ring->mask);
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+        if(difference == 0)
+        {
+            if(atomic_compare_exchange_weak_explicit(&ring->enqueue_position, &position, position + 1,
+                                                     memory_order_relaxed, memory_order_relaxed))
+            {
+                result = true;
+                break;
+            }
+        }
+        else if(difference < 0)
+        {
+            break; // NOTE(sokus): full
+        }
+        else
+        {
+            position = atomic_load_explicit(&ring->enqueue_position, memory_order_relaxed);
+        }
+    }
+    
+    if(result)
+    {
+        cell->load = *load;
+        atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    }
+    return result;
+}
+
+bool AssetRingPop(AssetRing *ring, AssetLoad *load)
+{
+    bool result = false;
+    AssetRingCell *cell = 0;
+    size_t position = atomic_load_explicit(&ring->dequeue_position, memory_order_relaxed);
+    for(;;)
+    {
+        cell = ring->cells + (position & ring->mask);
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+        if(difference == 0)
+        {
+            if(atomic_compare_exchange_weak_explicit(&ring->dequeue_position, &position, position + 1,
+                                                     memory_order_relaxed, memory_order_relaxed))
+            {
+                result = true;
+                break;
+            }
+        }
+        else if(difference < 0)
+        {
+            break; // NOTE(sokus): empty
+        }
+        else
+        {
+            position = atomic_load_explicit(&ring->dequeue_position, memory_order_relaxed);
+        }
+    }
+    
+    if(result)
+    {
+        *load = cell->load;
+        atomic_store_explicit(&cell->sequence, position + ring->mask + 1, memory_order_release);
+    }
+    return result;
+}
+
+#define ASSET_QUEUE_CAPACITY 64
+#define ASSET_QUEUE_MAX_THREADS 4
+
+typedef struct AssetQueue AssetQueue;
+
+typedef struct AssetWorker
+{
+    AssetQueue *queue;
+    pthread_t thread;
+    MemoryArena arena;
+} AssetWorker;
+
+struct AssetQueue
+{
+    AssetRing requests;
+    AssetRing completions;
+    sem_t requests_available;
+    AssetWorker workers[ASSET_QUEUE_MAX_THREADS];
+    int thread_count;
+    _Atomic bool quit;
+    SharedArena arena;
+    
+    // NOTE(sokus): Main thread only. Submits are refused once in_flight
+    // reaches the ring capacity, so workers can never find the completion
+    // ring full. popped_count is how many completed loads haven't been
+    // released yet.
+    int in_flight;
+    int popped_count;
+};
+
+// NOTE(sokus): With nothing in flight no worker is touching its arena, and
+// the ring handoffs order the clear before the next push into them.
+void Linux_ClearAssetArenasWhenIdle(AssetQueue *queue)
+{
+    if(queue->in_flight == 0 && queue->popped_count == 0)
+    {
+        for(int thread_idx = 0; thread_idx < queue->thread_count; ++thread_idx)
+            ClearArena(&queue->workers[thread_idx].arena);
+    }
+}
+
+void Linux_ReleaseAssetLoad(AssetQueue *queue, AssetLoad *load)
+{
+    if(load->kind == AssetKind_File)
+        Linux_UnmapFile(&load->file);
+    else if(load->kind == AssetKind_Image && load->image.data)
+        UnloadImage(&load->image);
+    MEMORY_SET(&load->image, 0, sizeof(load->image));
+    
+    if(load->popped)
+    {
+        load->popped = false;
+        --queue->popped_count;
+        Linux_ClearAssetArenasWhenIdle(queue);
+    }
+}
+
+void Linux_ProcessAssetLoad(AssetLoad *load, MemoryArena *arena)
+{
+    switch(load->kind)
+    {
+        case AssetKind_File:
+        {
+            load->file = Linux_MapFile(load->path, arena);
+            load->succeeded = (load->file.data != 0);
+        } break;
+        
+        case AssetKind_Image:
+        {
+            load->image = LoadImageEx(load->path, load->force_channels);
+            load->succeeded = (load->image.data != 0);
+        } break;
+        
+        // NOTE(sokus): Slicing here keeps the per-tile reshuffle off the
+        // render thread too, it only has to upload the result.
+        case AssetKind_TiledImage:
+        {
+            Image decoded = LoadImageEx(load->path, load->force_channels);
+            if(decoded.data)
+            {
+                size_t tiles_size = (size_t)(decoded.width * decoded.height * decoded.channels);
+                size_t used_before = arena->used;
+                if(!MemoryArenaCanFitAligned(arena, tiles_size, ARENA_DEFAULT_ALIGNMENT))
+                {
+                    fprintf(stderr, "ERROR: Not enough space for the tiles of %s in the asset arena.\n"
+                            "  Available: %zu  Needed: %zu\n",
+                            load->path, arena->size - arena->used, tiles_size);
+                }
+                else
+                {
+                    uint8_t *tiles = (uint8_t *)PUSH_SIZE(arena, tiles_size);
+                    if(SliceImageTiles(&decoded, load->tile_width, load->tile_height, tiles))
+                    {
+                        load->image = decoded;
+                        load->image.data = tiles;
+                        load->succeeded = true;
+                    }
+                    else
+                    {
+                        fprintf(stderr, "ERROR: Could not slice %s into %dx%d tiles\n",
+                                load->path, load->tile_width, load->tile_height);
+                        arena->used = used_before;
+                    }
+                }
+                UnloadImage(&decoded);
+            }
+        } break;
+        
+        default: INVALID_CODE_PATH; break;
+    }
+}
+
+void *Linux_AssetWorker(void *parameter)
+{
+    AssetWorker *worker = (AssetWorker *)parameter;
+    AssetQueue *queue = worker->queue;
+    for(;;)
+    {
+        while(sem_wait(&queue->requests_available) != 0 && errno == EINTR) {}
+        if(atomic_load(&queue->quit))
+            break;
+        
+        AssetLoad load;
+        if(AssetRingPop(&queue->requests, &load))
+        {
+            Linux_ProcessAssetLoad(&load, &worker->arena);
+            bool pushed = AssetRingPush(&queue->completions, &load);
+            ASSERT(pushed);
+        }
+    }
+    return 0;
+}
+
+// NOTE(sokus): arena_size is split evenly between the workers.
+bool Linux_StartAssetQueue(AssetQueue *queue, MemoryArena *arena, int thread_count, size_t arena_size)
+{
+    InitializeAssetRing(&queue->requests, arena, ASSET_QUEUE_CAPACITY);
+    InitializeAssetRing(&queue->completions, arena, ASSET_QUEUE_CAPACITY);
+    InitializeSharedArena(&queue->arena, (uint8_t *)PUSH_SIZE(arena, arena_size), arena_size);
+    queue->arena.tag = "asset loads";
+    atomic_init(&queue->quit, false);
+    queue->in_flight = 0;
+    queue->popped_count = 0;
+    queue->thread_count = 0;
+    
+    bool result = (sem_init(&queue->requests_available, 0, 0) == 0);
+    thread_count = CLAMP(1, thread_count, ASSET_QUEUE_MAX_THREADS);
+    size_t worker_arena_size = (arena_size / (size_t)thread_count) & ~(size_t)(ARENA_DEFAULT_ALIGNMENT - 1);
+    for(int thread_idx = 0; result && thread_idx < thread_count; ++thread_idx)
+    {
+        AssetWorker *worker = queue->workers + thread_idx;
+        worker->queue = queue;
+        result = (SharedArenaCarveArena(&queue->arena, &worker->arena, worker_arena_size, "asset worker") &&
+                  pthread_create(&worker->thread, 0, Linux_AssetWorker, worker) == 0);
+        if(result)
+            ++queue->thread_count;
+    }
+    if(!result)
+        fprintf(stderr, "ERROR: Could not start asset threads: %s\n", strerror(errno));
+    return result;
+}
+
+void Linux_StopAssetQueue(AssetQueue *queue)
+{
+    atomic_store(&queue->quit, true);
+    for(int thread_idx = 0; thread_idx < queue->thread_count; ++thread_idx)
+        sem_post(&queue->requests_available);
+    for(int thread_idx = 0; thread_idx < queue->thread_count; ++thread_idx)
+        pthread_join(queue->workers[thread_idx].thread, 0);
+    
+    AssetLoad load;
+    while(AssetRingPop(&queue->completions, &load))
+        Linux_ReleaseAssetLoad(queue, &load);
+    queue->thread_count = 0;
+    sem_destroy(&queue->requests_available);
+    queue->in_flight = 0;
+}
+
+// NOTE(sokus): Only the submitter half of the request is looked at.
+bool Linux_SubmitAssetLoad(AssetQueue *queue, AssetLoad *request)
+{
+    bool result = false;
+    if(queue->in_flight < ASSET_QUEUE_CAPACITY)
+    {
+        AssetLoad load = {0};
+        load.kind = request->kind;
+        load.path = request->path;
+        load.id = request->id;
+        load.force_channels = request->force_channels;
+        load.tile_width = request->tile_width;
+        load.tile_height = request->tile_height;
+        result = AssetRingPush(&queue->requests, &load);
+    }
+    
+    if(result)
+    {
+        ++queue->in_flight;
+        sem_post(&queue->requests_available);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Asset queue full, dropped %s\n", request->path);
+    }
+    return result;
+}
+
+// NOTE(sokus): The caller owns the completed load and has to release it
+// with Linux_ReleaseAssetLoad once it's done with the data.
+bool Linux_PopCompletedAssetLoad(AssetQueue *queue, AssetLoad *load)
+{
+    bool result = AssetRingPop(&queue->completions, load);
+    if(result)
+    {
+        load->popped = true;
+        --queue->in_flight;
+        ++queue->popped_count;
+    }
+    return result;
+}
@@ -0,0 +1,368 @@
+//~NOTE(sokus): job system
+
+// NOTE(sokus): Jobs are small tasks (a function and its data) that run on a
+// fixed set of threads, the main thread being thread 0. Every thread has
+// its own work-stealing deque: it pushes and pops jobs at the bottom of its
+// own deque, threads that run dry steal from the top of the others'. No
+// fibers, a thread waiting on a counter runs other jobs until the counter
+// hits zero, so waiting inside a job is fine and is how dependencies are
+// expressed (submit the children, wait for them, carry on).
+//
+// Job memory belongs to whoever submits it and has to stay valid until the
+// job's counter reaches zero, usually by living on the stack or in the
+// scratch arena of the job that waits for it.
+//
+// Every thread owns two arenas. The frame arena is for output that lives
+// until the main thread clears it (Linux_ClearJobFrameArenas), like the
+// per-thread render command lists. The scratch arena is per job, each job
+// runs inside a temporary block of it that's popped when the job returns.
+//
+// The thread count passed in includes the main thread, which runs jobs
+// while it waits on them, so N means N - 1 workers. Idle workers look for
+// work a few more times and then sleep on a semaphore, they don't keep a
+// core busy.
+
+#define JOB_MAX_THREADS 16
+#define JOB_DEQUE_CAPACITY 256 // power of two
+#define JOB_SPIN_COUNT 32      // tries before an idle worker goes to sleep
+
+typedef struct JobSystem JobSystem;
+
+typedef struct JobContext
+{
+    JobSystem *system;
+    int thread_idx;
+    MemoryArena *frame_arena;
+    MemoryArena *scratch_arena;
+} JobContext;
+
+typedef void JobFunction(JobContext *context, void *data);
+
+typedef struct JobCounter
+{
+    atomic_int value;
+} JobCounter;
+
+typedef struct Job
+{
+    JobFunction *function;
+    void *data;
+    JobCounter *counter;
+} Job;
+
+// NOTE(sokus): Chase-Lev deque, fixed size. The owner pushes and pops at
+// bottom, thieves take from top, the only contention is over the last job.
+typedef struct JobDeque
+{
+    _Atomic(Job *) jobs[JOB_DEQUE_CAPACITY];
+    _Alignas(64) atomic_llong top;
+    _Alignas(64) atomic_llong bottom;
+} JobDeque;
+
+typedef struct JobThread
+{
+    JobSystem *system;
+    int thread_idx;
+    pthread_t handle;
+    JobDeque deque;
+    MemoryArena frame_arena;
+    MemoryArena scratch_arena;
+} JobThread;
+
+struct JobSystem
+{
+    JobThread threads[JOB_MAX_THREADS];
+    int thread_count; // including the main thread
+    sem_t work_available;
+    _Atomic bool quit;
+};
+
+_Thread_local int linux_job_thread_idx = -1;
+
+bool JobDequePush(JobDeque *deque, Job *job)
+{
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    bool result = (bottom - top < JOB_DEQUE_CAPACITY);
+    if(result)
+    {
+        // NOTE(sokus): The release on bottom publishes the job (and what it
+        // points to) to whoever steals it.
+        atomic_store_explicit(deque->jobs + (bottom & (JOB_DEQUE_CAPACITY - 1)), job, memory_order_relaxed);
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+    }
+    return result;
+}
+
+Job *JobDequePop(JobDeque *deque)
+{
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    
+    Job *result = 0;
+    if(top <= bottom)
+    {
+        result = atomic_load_explicit(deque->jobs + (bottom & (JOB_DEQUE_CAPACITY - 1)), memory_order_relaxed);
+        if(top == bottom)
+        {
+            // NOTE(sokus): Last one, race the thieves for it.
+            if(!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                        memory_order_seq_cst, memory_order_relaxed))
+                result = 0;
+            atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        }
+    }
+    else
+    {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return result;
+}
+
+Job *JobDequeSteal(JobDeque *deque)
+{
+    long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    
+    Job *result = 0;
+    if(top < bottom)
+    {
+        result = atomic_load_explicit(deque->jobs + (top & (JOB_DEQUE_CAPACITY - 1)), memory_order_relaxed);
+        if(!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                    memory_order_seq_cst, memory_order_relaxed))
+            result = 0;
+    }
+    return result;
+}
+
+void Linux_RunJob(JobSystem *system, int thread_idx, Job *job)
+{
+    JobThread *thread = system->threads + thread_idx;
+    JobContext context;
+    context.system = system;
+    context.thread_idx = thread_idx;
+    context.frame_arena = &thread->frame_arena;
+    context.scratch_arena = &thread->scratch_arena;
+    
+    TemporaryMemory job_scratch = BeginTemporaryMemory(&thread->scratch_arena);
+    job->function(&context, job->data);
+    EndTemporaryMemory(job_scratch);
+    
+    if(job->counter)
+        atomic_fetch_sub_explicit(&job->counter->value, 1, memory_order_release);
+}
+
+// NOTE(sokus): Own deque first, then the others starting next door so the
+// thieves don't all go for the same victim.
+Job *Linux_FindJob(JobSystem *system, int thread_idx)
+{
+    JobThread *thread = system->threads + thread_idx;
+    Job *result = JobDequePop(&thread->deque);
+    for(int offset = 1; !result && offset < system->thread_count; ++offset)
+    {
+        int victim_idx = (thread_idx + offset) % system->thread_count;
+        result = JobDequeSteal(&system->threads[victim_idx].deque);
+    }
+    return result;
+}
+
+// NOTE(sokus): Spin-wait hint, tells the core (and its hyperthread sibling)
+// that we're only polling. Unlike sched_yield it's no syscall.
+void Linux_SpinPause(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+void *Linux_JobWorker(void *parameter)
+{
+    JobThread *thread = (JobThread *)parameter;
+    JobSystem *system = thread->system;
+    linux_job_thread_idx = thread->thread_idx;
+    
+    int idle_count = 0;
+    while(!atomic_load_explicit(&system->quit, memory_order_acquire))
+    {
+        Job *job = Linux_FindJob(system, thread->thread_idx);
+        if(job)
+        {
+            Linux_RunJob(system, thread->thread_idx, job);
+            idle_count = 0;
+        }
+        else if(++idle_count < JOB_SPIN_COUNT)
+        {
+            Linux_SpinPause();
+        }
+        else
+        {
+            // NOTE(sokus): Submitters post after pushing, a job that shows
+            // up after the last look wakes us right back up.
+            while(sem_wait(&system->work_available) != 0 && errno == EINTR) {}
+            idle_count = 0;
+        }
+    }
+    return 0;
+}
+
+bool Linux_StartJobSystem(JobSystem *system, int thread_count, size_t arena_reserve)
+{
+    MEMORY_SET(system, 0, sizeof(*system));
+    atomic_init(&system->quit, false);
+    thread_count = CLAMP(1, thread_count, JOB_MAX_THREADS);
+    
+    bool result = (sem_init(&system->work_available, 0, 0) == 0);
+    // NOTE(sokus): The frame arenas get cleared every frame and the scratch
+    // ones after every job, neither is worth decommitting.
+    for(int thread_idx = 0; result && thread_idx < thread_count; ++thread_idx)
+    {
+        JobThread *thread = system->threads + thread_idx;
+        thread->system = system;
+        thread->thread_idx = thread_idx;
+        atomic_init(&thread->deque.top, 0);
+        atomic_init(&thread->deque.bottom, 0);
+        result = (InitializeGrowableArena(&thread->frame_arena, arena_reserve, arena_reserve) &&
+                  InitializeGrowableArena(&thread->scratch_arena, arena_reserve, arena_reserve));
+        thread->frame_arena.tag = "job frame";
+        thread->scratch_arena.tag = "job scratch";
+    }
+    
+    // NOTE(sokus): The workers read thread_count to pick victims, it has to
+    // be set before they start. Not yet started threads just have empty deques.
+    linux_job_thread_idx = 0;
+    system->thread_count = thread_count;
+    for(int thread_idx = 1; result && thread_idx < thread_count; ++thread_idx)
+    {
+        JobThread *thread = system->threads + thread_idx;
+        result = (pthread_create(&thread->handle, 0, Linux_JobWorker, thread) == 0);
+    }
+    if(!result)
+        fprintf(stderr, "ERROR: Could not start job threads: %s\n", strerror(errno));
+    return result;
+}
+
+void Linux_StopJobSystem(JobSystem *system)
+{
+    atomic_store_explicit(&system->quit, true, memory_order_release);
+    for(int thread_idx = 1; thread_idx < system->thread_count; ++thread_idx)
+        sem_post(&system->work_available);
+    for(int thread_idx = 1; thread_idx < system->thread_count; ++thread_idx)
+        pthread_join(system->threads[thread_idx].handle, 0);
+    for(int thread_idx = 0; thread_idx < system->thread_count; ++thread_idx)
+    {
+        ReleaseArena(&system->threads[thread_idx].frame_arena);
+        ReleaseArena(&system->threads[thread_idx].scratch_arena);
+    }
+    sem_destroy(&system->work_available);
+    system->thread_count = 0;
+}
+
+// NOTE(sokus): Main thread only, between frames when no jobs are running.
+void Linux_ClearJobFrameArenas(JobSystem *system)
+{
+    for(int thread_idx = 0; thread_idx < system->thread_count; ++thread_idx)
+        ClearArena(&system->threads[thread_idx].frame_arena);
+}
+
+// NOTE(sokus): Can be called from the main thread or from inside a job. The
+// counter goes up by job_count and back down as the jobs finish. When the
+// deque is full the job runs right here instead.
+void Linux_SubmitJobs(JobSystem *system, Job *jobs, int job_count, JobCounter *counter)
+{
+    int thread_idx = linux_job_thread_idx;
+    ASSERT(thread_idx >= 0 && thread_idx < system->thread_count);
+    JobThread *thread = system->threads + thread_idx;
+    
+    atomic_fetch_add_explicit(&counter->value, job_count, memory_order_relaxed);
+    int pushed_count = 0;
+    for(int job_idx = 0; job_idx < job_count; ++job_idx)
+    {
+        Job *job = jobs + job_idx;
+        job->counter = counter;
+        if(JobDequePush(&thread->deque, job))
+            ++pushed_count;
+        else
+            Linux_RunJob(system, thread_idx, job);
+    }
+    
+    int wake_count = MIN(pushed_count, system->thread_count - 1);
+    for(int wake_idx = 0; wake_idx < wake_count; ++wake_idx)
+        sem_post(&system->work_available);
+}
+
+// NOTE(sokus): Runs jobs (our own first, then stolen ones) until the counter
+// reaches zero, so the waiting thread keeps working.
+void Linux_WaitForCounter(JobSystem *system, JobCounter *counter)
+{
+    int thread_idx = linux_job_thread_idx;
+    ASSERT(thread_idx >= 0 && thread_idx < system->thread_count);
+    while(atomic_load_explicit(&counter->value, memory_order_acquire) > 0)
+    {
+        Job *job = Linux_FindJob(system, thread_idx);
+        if(job)
+            Linux_RunJob(system, thread_idx, job);
+        else
+            sched_yield();
+    }
+}
+
+//~NOTE(sokus): parallel for
+
+typedef void ParallelForFunction(JobContext *context, void *data, int first, int count);
+
+typedef struct ParallelForJob
+{
+    ParallelForFunction *function;
+    void *data;
+    int first;
+    int count;
+} ParallelForJob;
+
+void Linux_RunParallelForJob(JobContext *context, void *data)
+{
+    ParallelForJob *range = (ParallelForJob *)data;
+    range->function(context, range->data, range->first, range->count);
+}
+
+// NOTE(sokus): Calls function over [0, count) in ranges of up to batch_size
+// spread over the job threads, and returns once all of them are done.
+void Linux_ParallelFor(JobSystem *system, ParallelForFunction *function, void *data,
+                       int count, int batch_size)
+{
+    ASSERT(batch_size > 0);
+    int job_count = (count + batch_size - 1) / batch_size;
+    if(job_count > 0)
+    {
+        // NOTE(sokus): Job descriptions go in the calling thread's scratch
+        // arena, popped again once they've all finished.
+        MemoryArena *scratch_arena = &system->threads[linux_job_thread_idx].scratch_arena;
+        TemporaryMemory job_memory = BeginTemporaryMemory(scratch_arena);
+        Job *jobs = PUSH_ARRAY(scratch_arena, Job, (size_t)job_count);
+        ParallelForJob *ranges = PUSH_ARRAY(scratch_arena, ParallelForJob, (size_t)job_count);
+        
+        // NOTE(sokus): Pushed last range first. We pop from the bottom of our
+        // deque so we go through the ranges in order, thieves take from the
+        // top, the far end.
+        for(int job_idx = 0; job_idx < job_count; ++job_idx)
+        {
+            ParallelForJob *range = ranges + job_idx;
+            range->function = function;
+            range->data = data;
+            range->first = (job_count - 1 - job_idx) * batch_size;
+            range->count = MIN(batch_size, count - range->first);
+            jobs[job_idx].function = Linux_RunParallelForJob;
+            jobs[job_idx].data = range;
+        }
+        
+        JobCounter counter;
+        atomic_init(&counter.value, 0);
+        Linux_SubmitJobs(system, jobs, job_count, &counter);
+        Linux_WaitForCounter(system, &counter);
+        EndTemporaryMemory(job_memory);
+    }
+}
@@ -2,6 +2,7 @@
 #include "wm_helpers.h"    
 #include "wm_platform.h"       // platform-game communication
 #include "wm_math.h"
+#include "wm_asset_pack.h"     // baked assets, see wm_asset_packer.c
 
 // External
 #include "SDL2/SDL.h"            // window/context creation
@@ -22,50 +23,142 @@
 #include <fcntl.h> // file control
 #include <errno.h>
 #include <string.h> // strerror
+#include <sys/mman.h> // mmap
 #include <sys/stat.h>
 #include <unistd.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
 
 #include "wm_linux.h"
 
 #include "wm_game.c"
 #include "wm_platform_sdl2.c"
+#include "wm_image.c"
 #include "wm_renderer_opengl3.c"
+#include "wm_linux_io.c"
+#include "wm_linux_jobs.c"
+#include "wm_linux_pacing.c"
 
-ReadFileResult Linux_ReadEntireFile(char *path, bool end_with_zero)
+typedef enum ShaderFileID
 {
-    ReadFileResult result = {0};
-    int fd = open(path, O_RDONLY);
+    ShaderFile_StandardVS,
+    ShaderFile_StandardFS,
+    ShaderFile_LightVS,
+    ShaderFile_LightFS,
     
-    if(fd > 0)
+    ShaderFile_Count,
+} ShaderFileID;
+
+// NOTE(sokus): Names are what the asset pack knows them by, paths are the
+// loose files we fall back to when the pack doesn't have them.
+typedef struct ShaderFileAsset
+{
+    char *name;
+    char *path;
+} ShaderFileAsset;
+
+global ShaderFileAsset shader_file_assets[ShaderFile_Count] = {
+    { "shaders/standard.vs", "../code/shaders/standard.vs" },
+    { "shaders/standard.fs", "../code/shaders/standard.fs" },
+    { "shaders/light.vs", "../code/shaders/light.vs" },
+    { "shaders/light.fs", "../code/shaders/light.fs" },
+};
+
+typedef struct TextureAsset
+{
+    char *name;
+    char *path;
+    int tile_width;
+    int tile_height;
+} TextureAsset;
+
+global TextureAsset texture_assets[TextureID_Count] = {
+    { "textures/sprites", "../assets/sprites.png", 16, 16 },
+    { "textures/glyphs", "../assets/glyphs.png", 8, 8 },
+};
+
+// NOTE(sokus): Links the program once both of its sources have come back
+// from the asset queue, the sources are released right after.
+void Linux_LinkProgramWhenLoaded(AssetQueue *queue, Program *program, AssetLoad *shader_loads,
+                                 ShaderFileID vertex_shader, ShaderFileID fragment_shader,
+                                 char *debug_name)
+{
+    AssetLoad *vertex_load = shader_loads + vertex_shader;
+    AssetLoad *fragment_load = shader_loads + fragment_shader;
+    if(!program->handle && vertex_load->file.data && fragment_load->file.data)
     {
-        struct stat file_stat;
-        fstat(fd, &file_stat);
-        uint32_t size = (uint32_t)file_stat.st_size; // NOTE(sokus): This limits our file size
-        if(end_with_zero)
-            size++;
-        void *data = valloc(size);
-        read(fd, data, size);
-        if(end_with_zero)
-            *((char *)data + size - 1) = 0;
-        
-        result.data = data;
-        result.size = size;
+        *program = CreateProgram((char *)vertex_load->file.data, vertex_load->file.size,
+                                 (char *)fragment_load->file.data, fragment_load->file.size,
+                                 debug_name);
+        Linux_ReleaseAssetLoad(queue, vertex_load);
+        Linux_ReleaseAssetLoad(queue, fragment_load);
     }
-    else
+}
+
+// NOTE(sokus): The cube field gets recorded as a parallel for over its rows,
+// a few rows per job. Each row is updated, culled as a whole against the
+// view and pushed into the command list of whichever thread ran the job.
+#define CUBE_FIELD_ROWS_PER_JOB 4
+
+typedef struct CubeFieldRecording
+{
+    CubeField *field;
+    RenderCommands *command_lists; // one per job thread
+    Program *program;
+    GLuint vao;
+    mat4 view;
+    Frustum frustum;
+    float near_plane;
+    float far_plane;
+    float time;
+} CubeFieldRecording;
+
+void Linux_RecordCubeFieldRows(JobContext *context, void *data, int first_row, int row_count)
+{
+    CubeFieldRecording *recording = (CubeFieldRecording *)data;
+    CubeField *field = recording->field;
+    TransformArrays *transforms = &field->transforms;
+    RenderCommands *commands = recording->command_lists + context->thread_idx;
+    
+    for(int row_idx = first_row; row_idx < first_row + row_count; ++row_idx)
     {
-        fprintf(stderr, "ERROR: Could not read file %s: %s\n", path, strerror(errno));
+        int first = row_idx * field->count_x;
+        int last = first + field->count_x - 1;
+        UpdateCubeField(field, first, field->count_x, recording->time);
+        
+        // NOTE(sokus): A sphere around the row, the cubes spin in place so
+        // their corners reach out to half the scaled diagonal.
+        vec3 row_start = Vec3(transforms->position_x[first], transforms->position_y[first],
+                              transforms->position_z[first]);
+        vec3 row_end = Vec3(transforms->position_x[last], transforms->position_y[last],
+                            transforms->position_z[last]);
+        vec3 row_center = MultiplyVec3f(AddVec3(row_start, row_end), 0.5f);
+        float cube_scale = MAX(transforms->scale_x[first], MAX(transforms->scale_y[first], transforms->scale_z[first]));
+        float radius = 0.5f * LengthVec3(SubtractVec3(row_end, row_start)) + 0.87f * cube_scale;
+        if(!SphereInFrustum(&recording->frustum, row_center, radius))
+            continue;
+        
+        float depth = RenderDepth(&recording->view, row_start, recording->near_plane, recording->far_plane);
+        PushDrawInstances(commands,
+                          MakeRenderKey(RenderPass_Opaque, recording->program->handle, recording->vao, depth),
+                          recording->program, recording->vao, 36,
+                          transforms, first, field->count_x, Vec4(0.4f, 0.5f, 0.6f, 1.0f));
     }
-    
-    return result;
 }
 
+#define SIMULATION_HZ 60
+#define SIMULATION_MAX_STEPS 8 // per frame, see the accumulator clamp
+
 int main(void)
 {
     bool is_running = false;
     bool fullscreen = false;
     bool mouse_relative = true;
-    float target_fps = 60.0f;
-    float dt = 1.0f / target_fps;
+    int target_fps = 0; // 0 follows the display's refresh rate
+    SwapMode swap_mode = SwapMode_AdaptiveVSync;
     
     int screen_width = 0;
     int screen_height = 0;
@@ -93,7 +186,14 @@ int main(void)
                                           window_flags);
     SDL_GLContext gl_context = SDL_GL_CreateContext(window);
     SDL_GL_MakeCurrent(window, gl_context);
-    // SDL_GL_SetSwapInterval(1);
+    SwapMode requested_swap_mode = swap_mode;
+    swap_mode = SDL2_SetSwapMode(requested_swap_mode);
+    if(swap_mode != requested_swap_mode)
+        fprintf(stderr, "NOTE: %s not available, using %s\n",
+                SwapModeName(requested_swap_mode), SwapModeName(swap_mode));
+    int refresh_rate = SDL2_GetRefreshRate(window);
+    if(target_fps == 0)
+        target_fps = (refresh_rate > 0) ? refresh_rate : 60;
     gladLoadGLLoader(SDL_GL_GetProcAddress);
     
     glEnable(GL_DEPTH_TEST);
@@ -104,19 +204,119 @@ int main(void)
     glDisable(GL_STENCIL_TEST);
     glDisable(GL_SCISSOR_TEST);
     
-    GLuint standard_program, light_program;
+    // NOTE(sokus): Only the pages we actually push into get committed,
+    // so the reservation can be generous.
+    MemoryArena memory_arena;
+    if(!InitializeGrowableArena(&memory_arena, GIGABYTES(1), MEGABYTES(4)))
     {
-        ReadFileResult standard_vs = Linux_ReadEntireFile("../code/shaders/standard.vs", true);
-        ReadFileResult standard_fs = Linux_ReadEntireFile("../code/shaders/standard.fs", true);
-        standard_program = CreateProgram((char *)standard_vs.data, (char *)standard_fs.data, "standard shader");
-        free(standard_vs.data); free(standard_fs.data);
-        
-        ReadFileResult light_vs = Linux_ReadEntireFile("../code/shaders/light.vs", true);
-        ReadFileResult light_fs = Linux_ReadEntireFile("../code/shaders/light.fs", true);
-        light_program = CreateProgram((char *)light_vs.data, (char *)light_fs.data, "light shader");
-        free(light_vs.data); free(light_fs.data);
+        fprintf(stderr, "ERROR: Could not reserve memory: %s\n", strerror(errno));
+        return -1;
+    }
+    memory_arena.tag = "permanent";
+    
+    ScratchArenas scratch_arenas = {0};
+    for(int arena_idx = 0; arena_idx < (int)ARRAY_SIZE(scratch_arenas.arenas); ++arena_idx)
+    {
+        if(!InitializeGrowableArena(scratch_arenas.arenas + arena_idx, MEGABYTES(256), MEGABYTES(1)))
+        {
+            fprintf(stderr, "ERROR: Could not reserve scratch memory: %s\n", strerror(errno));
+            return -1;
+        }
+        scratch_arenas.arenas[arena_idx].tag = "frame scratch";
+    }
+    
+    // NOTE(sokus): Whatever the asset pack has is used in place, straight
+    // from the mapping. Anything else loads in the background from loose
+    // files, and whatever isn't there yet just doesn't get drawn.
+    MappedFile pack_file = {0};
+    AssetPack asset_pack = {0};
+    if(access(ASSET_PACK_FILE_NAME, R_OK) == 0)
+    {
+        pack_file = Linux_MapFile(ASSET_PACK_FILE_NAME, 0);
+        if(!InitializeAssetPack(&asset_pack, pack_file.data, pack_file.size))
+        {
+            fprintf(stderr, "ERROR: %s is not a valid asset pack, using loose files\n", ASSET_PACK_FILE_NAME);
+            Linux_UnmapFile(&pack_file);
+        }
     }
     
+    // NOTE(sokus): One thread per core all together. The asset threads get a
+    // quarter of the cores (at least one), the job system the rest, counting
+    // the main thread.
+    int core_count = MAX((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+    int asset_thread_count = CLAMP(1, core_count / 4, ASSET_QUEUE_MAX_THREADS);
+    int job_thread_count = MAX(core_count - asset_thread_count, 1);
+    
+    AssetQueue asset_queue;
+    if(!Linux_StartAssetQueue(&asset_queue, &memory_arena, asset_thread_count, MEGABYTES(16)))
+        return -1;
+    
+    JobSystem job_system;
+    if(!Linux_StartJobSystem(&job_system, job_thread_count, MEGABYTES(64)))
+        return -1;
+    
+    AssetLoad shader_loads[ShaderFile_Count] = {0};
+    for(int shader_file_idx = 0; shader_file_idx < ShaderFile_Count; ++shader_file_idx)
+    {
+        ShaderFileAsset *shader_file_asset = shader_file_assets + shader_file_idx;
+        AssetPackEntry *entry = FindAssetPackEntry(&asset_pack, shader_file_asset->name);
+        if(entry && entry->type == AssetPackEntry_Raw)
+        {
+            // NOTE(sokus): A view into the pack, releasing it is a no-op.
+            shader_loads[shader_file_idx].kind = AssetKind_File;
+            shader_loads[shader_file_idx].file.data = GetAssetPackData(&asset_pack, entry);
+            shader_loads[shader_file_idx].file.size = entry->size;
+        }
+        else
+        {
+            AssetLoad request = {0};
+            request.kind = AssetKind_File;
+            request.path = shader_file_asset->path;
+            request.id = (uint32_t)shader_file_idx;
+            Linux_SubmitAssetLoad(&asset_queue, &request);
+        }
+    }
+    
+    // NOTE(sokus): Atlases stream in through pixel buffers, loose ones keep
+    // their asset load around until the streamer is done reading the tiles.
+    TextureStreamer texture_streamer;
+    InitializeTextureStreamer(&texture_streamer, &memory_arena, KILOBYTES(256), KILOBYTES(512));
+    AssetLoad streaming_loads[TextureID_Count] = {0};
+    
+    OpenGL3_Texture textures[TextureID_Count] = {0};
+    for(int texture_idx = 0; texture_idx < TextureID_Count; ++texture_idx)
+    {
+        TextureAsset *texture_asset = texture_assets + texture_idx;
+        AssetPackEntry *entry = FindAssetPackEntry(&asset_pack, texture_asset->name);
+        AssetPackImage *image = ((entry && entry->type == AssetPackEntry_TileImage &&
+                                  entry->size >= sizeof(AssetPackImage)) ?
+                                 (AssetPackImage *)GetAssetPackData(&asset_pack, entry) : 0);
+        if(image && image->mip_count > 0 &&
+           entry->size - sizeof(AssetPackImage) >= AssetPackImageDataSize(image))
+        {
+            GLenum internal_format = (image->format == AssetPackImage_BC7 ? GL_COMPRESSED_RGBA_BPTC_UNORM :
+                                      OpenGL3_TextureFormat((int)image->channels));
+            OpenGL3_CreateStreamedTexture(textures + texture_idx, &texture_streamer, (uint8_t *)(image + 1),
+                                          (int)image->tile_width, (int)image->tile_height,
+                                          (int)image->tile_count_x, (int)image->tile_count_y,
+                                          (int)image->channels, internal_format, (int)image->mip_count,
+                                          (uint32_t)texture_idx);
+        }
+        else
+        {
+            AssetLoad request = {0};
+            request.kind = AssetKind_TiledImage;
+            request.path = texture_asset->path;
+            request.id = (uint32_t)texture_idx;
+            request.tile_width = texture_asset->tile_width;
+            request.tile_height = texture_asset->tile_height;
+            Linux_SubmitAssetLoad(&asset_queue, &request);
+        }
+    }
+    
+    Program standard_program = {0};
+    Program light_program = {0};
+    
     float vertices[] = {
         -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
         0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
@@ -191,96 +391,249 @@ int main(void)
     Camera camera = {0};
     InitializeCamera(&camera, 1.5f, 1.1f, 5.0f, -90.0f, 0.0f, 0.2f, 1.0f);
     
-    MemoryArena memory_arena;
-    unsigned char memory_buffer[4096];
-    InitializeArena(&memory_arena, memory_buffer, sizeof(memory_buffer));
+    GLuint frame_constants_buffer = CreateFrameConstantsBuffer();
+    
+    CubeField cube_field;
+    InitializeCubeField(&cube_field, &memory_arena, 48, 48, 0.5f, -1.5f);
+    
+    // NOTE(sokus): Room for every cube and the odd single draw, plus what the
+    // chunks waste: the tail a chunk loses when the next row doesn't fit (an
+    // eighth is plenty for rows of 48) and one chunk per thread left partly
+    // unused at the end of the frame.
+    InstanceBuffer instance_buffer;
+    int instance_capacity = (cube_field.count + cube_field.count / 8 + 16 +
+                             job_system.thread_count * INSTANCE_CHUNK_SIZE);
+    InitializeInstanceBuffer(&instance_buffer, instance_capacity);
+    RenderStats render_stats = {0};
+    AttachInstanceBufferToVertexArray(&instance_buffer, cube_vao);
+    AttachInstanceBufferToVertexArray(&instance_buffer, light_vao);
+    
+    // NOTE(sokus): The simulation (input, camera) runs in fixed steps of
+    // SIMULATION_HZ no matter the frame rate, so it behaves the same on every
+    // display. The accumulator counts real time in ticks * SIMULATION_HZ,
+    // which makes a step exactly one performance frequency, no rounding. The
+    // renderer draws in between the last two steps, alpha of the way.
+    uint64_t performance_frequency = SDL_GetPerformanceFrequency();
+    uint64_t simulation_accumulator = 0;
+    uint64_t simulation_step_count = 0;
+    float simulation_dt = 1.0f / (float)SIMULATION_HZ;
+    Camera previous_camera = camera;
+    
+    // NOTE(sokus): When the swap waits for vsync it paces the frames already,
+    // the pacer only has to step in below the refresh rate.
+    bool swap_waits = (swap_mode != SwapMode_Immediate && refresh_rate > 0 && target_fps >= refresh_rate);
+    FramePacer frame_pacer;
+    Linux_StartFramePacer(&frame_pacer, target_fps, !swap_waits);
     
     unsigned long int last_counter = SDL_GetPerformanceCounter();
     is_running = true;
     while(is_running)
     {
+        BeginScratchFrame(&scratch_arenas);
+        
+        // NOTE(sokus): After a hitch (breakpoint, window drag, a slow load)
+        // catching up on every step would make the next frame slow too, and
+        // so on. Anything past SIMULATION_MAX_STEPS gets dropped instead.
+        unsigned long int frame_counter = SDL_GetPerformanceCounter();
+        simulation_accumulator += (uint64_t)(frame_counter - last_counter) * SIMULATION_HZ;
+        simulation_accumulator = MIN(simulation_accumulator, SIMULATION_MAX_STEPS * performance_frequency);
+        last_counter = frame_counter;
+        
+        AssetLoad asset_load;
+        while(Linux_PopCompletedAssetLoad(&asset_queue, &asset_load))
+        {
+            if(asset_load.succeeded && asset_load.kind == AssetKind_File)
+            {
+                // NOTE(sokus): Stays around until its program links.
+                shader_loads[asset_load.id] = asset_load;
+            }
+            else if(asset_load.succeeded && asset_load.kind == AssetKind_TiledImage)
+            {
+                Image *image = &asset_load.image;
+                if(OpenGL3_CreateStreamedTexture(textures + asset_load.id, &texture_streamer, image->data,
+                                                 asset_load.tile_width, asset_load.tile_height,
+                                                 image->width / asset_load.tile_width,
+                                                 image->height / asset_load.tile_height,
+                                                 image->channels, OpenGL3_TextureFormat(image->channels),
+                                                 1, asset_load.id))
+                    streaming_loads[asset_load.id] = asset_load;
+                else
+                    Linux_ReleaseAssetLoad(&asset_queue, &asset_load);
+            }
+            else
+            {
+                Linux_ReleaseAssetLoad(&asset_queue, &asset_load);
+            }
+        }
+        
+        uint32_t finished_textures[TextureID_Count];
+        int finished_texture_count = UpdateTextureStreamer(&texture_streamer, finished_textures,
+                                                           (int)ARRAY_SIZE(finished_textures));
+        for(int finished_idx = 0; finished_idx < finished_texture_count; ++finished_idx)
+        {
+            AssetLoad *streaming_load = streaming_loads + finished_textures[finished_idx];
+            if(streaming_load->succeeded)
+                Linux_ReleaseAssetLoad(&asset_queue, streaming_load);
+            MEMORY_SET(streaming_load, 0, sizeof(*streaming_load));
+        }
+        Linux_LinkProgramWhenLoaded(&asset_queue, &standard_program, shader_loads,
+                                    ShaderFile_StandardVS, ShaderFile_StandardFS, "standard shader");
+        Linux_LinkProgramWhenLoaded(&asset_queue, &light_program, shader_loads,
+                                    ShaderFile_LightVS, ShaderFile_LightFS, "light shader");
+        
         SDL_GetWindowSize(window, &screen_width, &screen_height);
         glViewport(0, 0, screen_width, screen_height);
         
-        input.mouse_rel_x = 0;
-        input.mouse_rel_y = 0;
+        // NOTE(sokus): Mouse motion adds up until a step consumes it, frames
+        // without a step don't lose any.
         SDL_Event event;
         while(SDL_PollEvent(&event))
             SDL2_ProcessEvent(&event, window, &input, &is_running, &fullscreen, &mouse_relative);
         SDL_SetRelativeMouseMode(mouse_relative);
         
-        UpdateInput(&input, dt);
+        while(simulation_accumulator >= performance_frequency)
+        {
+            previous_camera = camera;
+            UpdateInput(&input, simulation_dt);
+            
+            if(mouse_relative)
+                ProcessMouse(&camera, (float)input.mouse_rel_x, (float)input.mouse_rel_y);
+            input.mouse_rel_x = 0;
+            input.mouse_rel_y = 0;
+            
+            int move_x = (int)IsDown(&input, InputKey_MoveRight) - (int)IsDown(&input, InputKey_MoveLeft);
+            int move_z = (int)IsDown(&input, InputKey_MoveUp) - (int)IsDown(&input, InputKey_MoveDown);
+            
+            float move_speed = 2.0f;
+            float move_amount_x = (float)move_x * move_speed;
+            float move_amount_z = (float)move_z * move_speed;
+            
+            MoveCameraRelative(&camera, move_amount_z, move_amount_x, simulation_dt);
+            
+            simulation_accumulator -= performance_frequency;
+            ++simulation_step_count;
+        }
         
-        if(mouse_relative)
-            ProcessMouse(&camera, (float)input.mouse_rel_x, (float)input.mouse_rel_y);
+        // NOTE(sokus): The cube field is a function of time, interpolating
+        // it is just evaluating it at the interpolated time. Before the first
+        // step there's nothing to interpolate from, so it stays at zero.
+        float alpha = (float)simulation_accumulator / (float)performance_frequency;
+        Camera render_camera = InterpolateCamera(&previous_camera, alpha, &camera);
+        float time = MAX(((float)simulation_step_count - 1.0f + alpha) * simulation_dt, 0.0f);
         
         vec3 light_pos = Vec3(1.5f, 2.0f, 1.0f);
-        int move_x = (int)IsDown(&input, InputKey_MoveRight) - (int)IsDown(&input, InputKey_MoveLeft);
-        int move_z = (int)IsDown(&input, InputKey_MoveUp) - (int)IsDown(&input, InputKey_MoveDown);
-        
-        float move_speed = 2.0f;
-        float move_amount_x = (float)move_x * move_speed;
-        float move_amount_z = (float)move_z * move_speed;
-        
-        MoveCameraRelative(&camera, move_amount_z, move_amount_x, dt);
         
         //glClearColor(46.0f/256.0f, 34.0f/256.0f, 47.0f/256.0f, 1.0f);
         glClearColor(0.2f, 0.3f, 0.4f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
-        glUseProgram(standard_program);
-        SetVec3Uniform(standard_program, "objectColor", 1.0f, 0.5f, 0.31f);
-        SetVec3Uniform(standard_program, "lightColor", 1.0f, 1.0f, 1.0f);
-        SetVec3Uniform(standard_program, "lightPos", light_pos.x, light_pos.y, light_pos.z);
-        
         // view/projection transformations
-        mat4 view = GetCameraViewMatrix(&camera);
-        mat4 projection = Perspective(40.0f, (float)screen_width / (float)screen_height, 0.1f, 100.0f);
-        SetMat4Uniform(standard_program, "projection", &projection);
-        SetMat4Uniform(standard_program, "view", &view);
-        
-        // world transformation
-        mat4 model = Mat4d(1.0f);
-        SetMat4Uniform(standard_program, "model", &model);
-        
-        // render the cube
-        glBindVertexArray(cube_vao);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        
-        
-        // also draw the lamp object
-        glUseProgram(light_program);
-        SetMat4Uniform(light_program, "projection", &projection);
-        SetMat4Uniform(light_program, "view", &view);
-        model = Mat4d(1.0f);
-        model = Scale(model, 0.2f, 0.2f, 0.2f);
-        model = Translate(model, light_pos.x, light_pos.y, light_pos.z);
-        SetMat4Uniform(light_program, "model", &model);
-        
-        glBindVertexArray(light_vao);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        float near_plane = 0.1f;
+        float far_plane = 100.0f;
+        mat4 view = GetCameraViewMatrix(&render_camera);
+        mat4 projection = Perspective(40.0f, (float)screen_width / (float)screen_height, near_plane, far_plane);
         
+        FrameConstants frame_constants = {0};
+        frame_constants.view = view;
+        frame_constants.projection = projection;
+        frame_constants.view_projection = MultiplyMat4(projection, view);
+        frame_constants.light_pos = Vec4v(light_pos, 1.0f);
+        frame_constants.view_light_pos = MultiplyMat4ByVec4(view, frame_constants.light_pos);
+        frame_constants.light_color = Vec4(1.0f, 1.0f, 1.0f, 1.0f);
+        frame_constants.time = time;
+        UpdateFrameConstants(frame_constants_buffer, &frame_constants);
         
-        SDL_GL_SwapWindow(window);
+        // NOTE(sokus): Pushed in whatever order is convenient, and from
+        // whichever thread, executing merges the lists, sorts them by state
+        // and merges what it can into instanced draws. Every job thread
+        // records into a list in its own frame arena, list 0 is ours. The
+        // instances all go into the one mapped instance buffer.
+        MemoryArena *frame_arena = GetScratchArena(&scratch_arenas);
+        Linux_ClearJobFrameArenas(&job_system);
+        MapInstanceBuffer(&instance_buffer);
+        int command_list_count = job_system.thread_count;
+        RenderCommands *command_lists = PUSH_ARRAY(frame_arena, RenderCommands, (size_t)command_list_count);
+        for(int list_idx = 0; list_idx < command_list_count; ++list_idx)
+        {
+            BeginRenderCommands(command_lists + list_idx, &job_system.threads[list_idx].frame_arena,
+                                cube_field.count_z + 16, &instance_buffer, &frame_constants);
+        }
+        RenderCommands *render_commands = command_lists + 0;
         
-        // Timing
-        unsigned long int work_counter = SDL_GetPerformanceCounter();
-        float work_in_seconds = SDL2_GetSecondsElapsed(last_counter, work_counter);
+        // the lamp object
+        if(light_program.handle)
+        {
+            mat4 model = Mat4FromTRSQuat(light_pos, QuatIdentity(), Vec3(0.2f, 0.2f, 0.2f));
+            float depth = RenderDepth(&view, light_pos, near_plane, far_plane);
+            PushDrawInstance(render_commands,
+                             MakeRenderKey(RenderPass_Opaque, light_program.handle, light_vao, depth),
+                             &light_program, light_vao, 36, &model, Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+        }
         
-        if(work_in_seconds < dt)
+        // the cube
+        if(standard_program.handle)
         {
-            float sec_to_sleep = dt - work_in_seconds;
-            unsigned int ms_to_sleep = (unsigned int)(sec_to_sleep * 1000.0f) + 1;
-            SDL_Delay(ms_to_sleep);
+            mat4 model = Mat4d(1.0f);
+            float depth = RenderDepth(&view, Vec3(0.0f, 0.0f, 0.0f), near_plane, far_plane);
+            PushDrawInstance(render_commands,
+                             MakeRenderKey(RenderPass_Opaque, standard_program.handle, cube_vao, depth),
+                             &standard_program, cube_vao, 36, &model, Vec4(1.0f, 0.5f, 0.31f, 1.0f));
+            
+            // and the floor of cubes under it
+            CubeFieldRecording recording = {0};
+            recording.field = &cube_field;
+            recording.command_lists = command_lists;
+            recording.program = &standard_program;
+            recording.vao = cube_vao;
+            recording.view = view;
+            recording.frustum = FrustumFromMatrix(frame_constants.view_projection);
+            recording.near_plane = near_plane;
+            recording.far_plane = far_plane;
+            recording.time = time;
+            Linux_ParallelFor(&job_system, Linux_RecordCubeFieldRows, &recording,
+                              cube_field.count_z, CUBE_FIELD_ROWS_PER_JOB);
         }
         
-        last_counter = SDL_GetPerformanceCounter();
+        ExecuteRenderCommands(command_lists, command_list_count, frame_arena, &instance_buffer, &render_stats);
+        
+        Linux_WaitForFrameDeadline(&frame_pacer);
+        SDL_GL_SwapWindow(window);
+    }
+    
+    Linux_StopJobSystem(&job_system);
+    Linux_StopAssetQueue(&asset_queue);
+    for(int shader_file_idx = 0; shader_file_idx < ShaderFile_Count; ++shader_file_idx)
+        Linux_ReleaseAssetLoad(&asset_queue, shader_loads + shader_file_idx);
+    for(int texture_idx = 0; texture_idx < TextureID_Count; ++texture_idx)
+    {
+        if(streaming_loads[texture_idx].succeeded)
+            Linux_ReleaseAssetLoad(&asset_queue, streaming_loads + texture_idx);
     }
+    DestroyTextureStreamer(&texture_streamer);
+    OpenGL3_DestroyTextures(textures, TextureID_Count);
+    Linux_UnmapFile(&pack_file);
     
-    glDeleteBuffers(1, &cube_vao);
+    DestroyInstanceBuffer(&instance_buffer);
+#if WM_RENDER_STATS
+    DumpRenderStats(&render_stats, stdout);
+#endif
+#if WM_PACING_STATS
+    DumpFramePacingStats(&frame_pacer, stdout);
+#endif
+#if WM_ARENA_STATS
+    DumpArenaStats(&memory_arena, stdout);
+    DumpArenaStats(scratch_arenas.arenas + 0, stdout);
+    DumpArenaStats(scratch_arenas.arenas + 1, stdout);
+#endif
+    ReleaseArena(&memory_arena);
+    ReleaseArena(scratch_arenas.arenas + 0);
+    ReleaseArena(scratch_arenas.arenas + 1);
+    glDeleteBuffers(1, &frame_constants_buffer);
+    glDeleteVertexArrays(1, &cube_vao);
+    glDeleteVertexArrays(1, &light_vao);
     glDeleteBuffers(1, &vbo);
-    glDeleteProgram(standard_program);
-    glDeleteProgram(light_program);
+    glDeleteProgram(standard_program.handle);
+    glDeleteProgram(light_program.handle);
     
     SDL_GL_DeleteContext(gl_context);
     SDL_DestroyWindow(window);
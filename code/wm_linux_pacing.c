@@ -0,0 +1,133 @@
+//~NOTE(sokus): frame pacing
+
+// NOTE(sokus): Ticks are CLOCK_MONOTONIC nanoseconds in an int64, the same
+// clock clock_nanosleep sleeps on, so deadlines need no conversion. Frames
+// get absolute deadlines one target period apart, the pacer sleeps until a
+// little before the deadline and spins the rest of the way. The scheduler
+// can wake us late by a lot more than a millisecond, the spin margin
+// follows how late it has actually been.
+//
+// With vsync the swap already blocks until the next refresh, sleeping on
+// top of that only risks missing one, so the pacer then just measures.
+
+#ifndef WM_PACING_STATS
+#define WM_PACING_STATS 0
+#endif
+
+#define PACING_TICKS_PER_SECOND 1000000000ll
+#define PACING_MIN_SPIN_TICKS 200000ll  // 0.2ms
+#define PACING_MAX_SPIN_TICKS 4000000ll // 4ms
+#define PACING_LATE_TICKS 1000000ll     // a frame this much over target counts as late
+
+// NOTE(sokus): Always counted, set WM_PACING_STATS to 1 to have main dump
+// them on exit. Mean and variance are kept with Welford's method.
+typedef struct FramePacingStats
+{
+    int64_t frame_count;
+    int64_t late_count;
+    int64_t min_frame_ticks;
+    int64_t max_frame_ticks;
+    double mean_frame_ticks;
+    double frame_ticks_m2;
+} FramePacingStats;
+
+typedef struct FramePacer
+{
+    int64_t target_frame_ticks;
+    int64_t deadline;
+    int64_t last_frame_ticks; // when the last frame was let through
+    int64_t spin_ticks;
+    bool sleeps;
+    FramePacingStats stats;
+} FramePacer;
+
+int64_t Linux_GetTicks(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t result = (int64_t)now.tv_sec * PACING_TICKS_PER_SECOND + (int64_t)now.tv_nsec;
+    return result;
+}
+
+void Linux_SleepUntil(int64_t ticks)
+{
+    struct timespec wake_time;
+    wake_time.tv_sec = (time_t)(ticks / PACING_TICKS_PER_SECOND);
+    wake_time.tv_nsec = (long)(ticks % PACING_TICKS_PER_SECOND);
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_time, 0) == EINTR) {}
+}
+
+// NOTE(sokus): sleeps is false when the swap itself waits for the display.
+void Linux_StartFramePacer(FramePacer *pacer, int target_fps, bool sleeps)
+{
+    MEMORY_SET(pacer, 0, sizeof(*pacer));
+    pacer->target_frame_ticks = PACING_TICKS_PER_SECOND / MAX(target_fps, 1);
+    pacer->spin_ticks = PACING_MAX_SPIN_TICKS / 2;
+    pacer->sleeps = sleeps;
+    pacer->last_frame_ticks = Linux_GetTicks();
+    pacer->deadline = pacer->last_frame_ticks + pacer->target_frame_ticks;
+    pacer->stats.min_frame_ticks = INT64_MAX;
+}
+
+void Linux_RecordFrameTicks(FramePacingStats *stats, int64_t frame_ticks, int64_t target_frame_ticks)
+{
+    ++stats->frame_count;
+    if(frame_ticks > target_frame_ticks + PACING_LATE_TICKS)
+        ++stats->late_count;
+    stats->min_frame_ticks = MIN(stats->min_frame_ticks, frame_ticks);
+    stats->max_frame_ticks = MAX(stats->max_frame_ticks, frame_ticks);
+    
+    double delta = (double)frame_ticks - stats->mean_frame_ticks;
+    stats->mean_frame_ticks += delta / (double)stats->frame_count;
+    stats->frame_ticks_m2 += delta * ((double)frame_ticks - stats->mean_frame_ticks);
+}
+
+// NOTE(sokus): Call right before the swap. Returns once the frame's deadline
+// has come (or right away if it already passed) and moves on to the next one.
+void Linux_WaitForFrameDeadline(FramePacer *pacer)
+{
+    int64_t now = Linux_GetTicks();
+    if(pacer->sleeps)
+    {
+        int64_t wake_ticks = pacer->deadline - pacer->spin_ticks;
+        if(now < wake_ticks)
+        {
+            Linux_SleepUntil(wake_ticks);
+            
+            // NOTE(sokus): Grow the margin right away when a wake-up comes
+            // in late, shrink it slowly when they're on time.
+            int64_t oversleep = Linux_GetTicks() - wake_ticks;
+            int64_t spin_ticks = MAX(pacer->spin_ticks - pacer->spin_ticks / 16, 2 * oversleep);
+            pacer->spin_ticks = CLAMP(PACING_MIN_SPIN_TICKS, spin_ticks, PACING_MAX_SPIN_TICKS);
+        }
+        
+        do
+        {
+            now = Linux_GetTicks();
+        } while(now < pacer->deadline);
+        
+        // NOTE(sokus): A late frame isn't caught up on with a short one after
+        // it, that's two bad frames instead of one. The schedule restarts
+        // from now. On time, now is within a spin of the deadline.
+        if(now - pacer->deadline > PACING_MIN_SPIN_TICKS)
+            pacer->deadline = now + pacer->target_frame_ticks;
+        else
+            pacer->deadline += pacer->target_frame_ticks;
+    }
+    
+    Linux_RecordFrameTicks(&pacer->stats, now - pacer->last_frame_ticks, pacer->target_frame_ticks);
+    pacer->last_frame_ticks = now;
+}
+
+void DumpFramePacingStats(FramePacer *pacer, FILE *stream)
+{
+    FramePacingStats *stats = &pacer->stats;
+    double to_ms = 1000.0 / (double)PACING_TICKS_PER_SECOND;
+    double variance = (stats->frame_count > 1) ? stats->frame_ticks_m2 / (double)(stats->frame_count - 1) : 0.0;
+    fprintf(stream, "pacing: %lld frames, target %.3f ms, mean %.3f ms, jitter (stddev) %.3f ms, "
+            "min %.3f ms, max %.3f ms, %lld late\n",
+            (long long)stats->frame_count, (double)pacer->target_frame_ticks * to_ms,
+            stats->mean_frame_ticks * to_ms, sqrt(variance) * to_ms,
+            (double)MIN(stats->min_frame_ticks, stats->max_frame_ticks) * to_ms,
+            (double)stats->max_frame_ticks * to_ms, (long long)stats->late_count);
+}
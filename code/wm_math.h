@@ -5,6 +5,34 @@
 
 #include "math.h"    // sinf, cosf ...
 #include "stdbool.h" // comparisons
+#include "stdint.h"  // uint32_t, float bit manipulation
+
+// Define WM_MATH_FAST to route SinCosF and Exp2F through the Fast*
+// approximations below instead of the CRT, the two that beat it in
+// wm_bench. SinCosF is what QuatFromAxisAngle and the cube field update
+// use, so that's where the game feels it. The others are only used when called by name: FastSinF,
+// FastCosF, FastLog2F and FastPowerF are no faster than the CRT, and
+// FastRSquareRootF only wins on throughput, it is no shorter than
+// sqrtss + divss when its result is waited on, as in NormalizeQuat.
+#ifndef WM_MATH_FAST
+#define WM_MATH_FAST 0
+#endif
+
+// SIMD backend, picked at compile time from the target flags (-msse2, -mavx).
+// Define WM_MATH_NO_SIMD to force the scalar reference path.
+#if !defined(WM_MATH_NO_SIMD) && defined(__SSE2__)
+#define WM_MATH_SSE 1
+#include <emmintrin.h>
+#else
+#define WM_MATH_SSE 0
+#endif
+
+#if WM_MATH_SSE && defined(__AVX__)
+#define WM_MATH_AVX 1
+#include <immintrin.h>
+#else
+#define WM_MATH_AVX 0
+#endif
 
 // macros for easy CRT substitution
 #ifndef SINF
@@ -31,6 +59,14 @@
 #define LOGF logf
 #endif
 
+#ifndef EXP2F
+#define EXP2F exp2f
+#endif
+
+#ifndef LOG2F
+#define LOG2F log2f
+#endif
+
 #ifndef ACOSF
 #define ACOSF acosf
 #endif
@@ -82,9 +118,14 @@ typedef union vec3
     struct { float ingored1; vec2 yz; };
 } vec3;
 
+// NOTE(sokus): vec4 (and so mat4) is 16 byte aligned on every path, so the
+// memory layout doesn't change when switching between SIMD and scalar.
 typedef union vec4
 {
-    float elements[4];
+    _Alignas(16) float elements[4];
+#if WM_MATH_SSE
+    __m128 sse;
+#endif
     
     struct
     {
@@ -107,12 +148,165 @@ typedef union vec4
     };
 } vec4;
 
+// NOTE(sokus): Unit quaternions represent rotations, w is the scalar part.
+typedef union quat
+{
+    _Alignas(16) float elements[4];
+#if WM_MATH_SSE
+    __m128 sse;
+#endif
+    struct { float x, y, z, w; };
+    struct { vec3 xyz; float ignored2; };
+} quat;
+
+typedef union mat3
+{
+    float elements[3][3];
+    vec3 columns[3];
+} mat3;
+
 typedef union mat4
 {
     float elements[4][4];
     vec4 columns[4];
 } mat4;
 
+// fast approximations
+// NOTE(sokus): Max errors were measured against the double precision CRT
+// functions, see wm_bench.c for the comparison with the float CRT path.
+
+typedef union FloatBits
+{
+    float f;
+    uint32_t u;
+} FloatBits;
+
+// Cody-Waite reduction to [-pi/4, pi/4] plus minimax polynomials for both
+// sin and cos, the quadrant picks which one is used and the sign.
+// Max abs error: 8e-8 for |x| <= 8192, only valid for |x| < 2^22.
+void FastSinCosF(float radians, float *sin_out, float *cos_out)
+{
+    // NOTE(sokus): Adding 1.5 * 2^23 rounds to the nearest integer and leaves
+    // it in the low mantissa bits, subtracting it again gives the float.
+    FloatBits rounded;
+    rounded.f = radians * 0.636619772f + 12582912.0f; // 2/pi
+    float k = rounded.f - 12582912.0f;
+    uint32_t quadrant = rounded.u;
+    
+    // pi/2 split in three parts so the subtraction stays exact
+    float r = radians - k * 1.5703125f;
+    r = r - k * 4.837512969970703125e-4f;
+    r = r - k * 7.549789954891882e-8f;
+    float r2 = r * r;
+    
+    FloatBits sin_r, cos_r;
+    sin_r.f = ((-1.9515295891e-4f * r2 + 8.3321608736e-3f) * r2 - 1.6666654611e-1f) * r2 * r + r;
+    cos_r.f = ((2.443315711809948e-5f * r2 - 1.388731625493765e-3f) * r2 + 4.166664568298827e-2f) * r2 * r2
+        - 0.5f * r2 + 1.0f;
+    
+    // NOTE(sokus): Odd quadrants swap sin and cos, quadrants 2 and 3 negate
+    // sin, 1 and 2 negate cos. Done on the bits so there are no branches.
+    uint32_t swap_mask = 0u - (quadrant & 1);
+    FloatBits sin_result, cos_result;
+    sin_result.u = (sin_r.u & ~swap_mask) | (cos_r.u & swap_mask);
+    cos_result.u = (cos_r.u & ~swap_mask) | (sin_r.u & swap_mask);
+    sin_result.u ^= (quadrant & 2) << 30;
+    cos_result.u ^= ((quadrant + 1) & 2) << 30;
+    
+    *sin_out = sin_result.f;
+    *cos_out = cos_result.f;
+}
+
+float FastSinF(float radians)
+{
+    float sin_value, cos_value;
+    FastSinCosF(radians, &sin_value, &cos_value);
+    return sin_value;
+}
+
+float FastCosF(float radians)
+{
+    float sin_value, cos_value;
+    FastSinCosF(radians, &sin_value, &cos_value);
+    return cos_value;
+}
+
+// Hardware estimate (or the bit trick without SSE) refined with Newton steps.
+// Max rel error: 3e-7 (SSE, one step), 2e-7 (scalar, three steps).
+float FastRSquareRootF(float x)
+{
+#if WM_MATH_SSE
+    // NOTE(sokus): _mm_set1_ps and not _mm_set_ss, gcc zeroes the upper
+    // lanes for the latter by bouncing x through a general purpose register.
+    float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set1_ps(x)));
+    y = y * (1.5f - 0.5f * x * y * y);
+#else
+    FloatBits bits;
+    bits.f = x;
+    bits.u = 0x5f375a86 - (bits.u >> 1);
+    float y = bits.f;
+    y = y * (1.5f - 0.5f * x * y * y);
+    y = y * (1.5f - 0.5f * x * y * y);
+    y = y * (1.5f - 0.5f * x * y * y);
+#endif
+    return y;
+}
+
+// 2^x, x clamped to [-126, 127]. Exponent goes straight into the float bits,
+// the fraction in [-0.5, 0.5] through a degree 6 polynomial.
+// Max rel error: 1e-7.
+float FastExp2F(float x)
+{
+    x = (x < -126.0f) ? -126.0f : x;
+    x = (x > 127.0f) ? 127.0f : x;
+    
+    // NOTE(sokus): Same rounding trick as in FastSinCosF.
+    FloatBits rounded;
+    rounded.f = x + 12582912.0f;
+    float f = x - (rounded.f - 12582912.0f);
+    
+    float p = ((((1.535336188319500e-4f * f + 1.339887440266574e-3f) * f + 9.618437357674640e-3f) * f
+                + 5.550332471162809e-2f) * f + 2.402264791363012e-1f) * f + 6.931472028550421e-1f;
+    
+    // low mantissa bits hold the exponent as a two's complement integer
+    FloatBits scale;
+    scale.u = (rounded.u + 127) << 23;
+    float result = (1.0f + f * p) * scale.f;
+    return result;
+}
+
+// log2(x) for positive normal x. Mantissa is reduced to [sqrt(1/2), sqrt(2)]
+// and log2(m) = 2/ln(2) * atanh((m-1)/(m+1)) through its odd series.
+// Max abs error: 1.5e-7 on top of rounding the result to float.
+float FastLog2F(float x)
+{
+    FloatBits bits;
+    bits.f = x;
+    int exponent = (int)((bits.u >> 23) & 0xff) - 127;
+    bits.u = (bits.u & 0x007fffff) | 0x3f800000;
+    float m = bits.f;
+    if(m > 1.41421356f)
+    {
+        m *= 0.5f;
+        exponent += 1;
+    }
+    
+    float t = (m - 1.0f) / (m + 1.0f);
+    float t2 = t * t;
+    float log2_m = t * (2.885390082f + t2 * (0.9617966939f + t2 * (0.5770780164f + t2 * 0.4121985868f)));
+    float result = (float)exponent + log2_m;
+    return result;
+}
+
+// base^exponent for positive base, errors of Exp2 and Log2 compound
+// with the size of the result's exponent. Max rel error: 2e-6 for results
+// in [2^-20, 2^20].
+float FastPowerF(float base, float exponent)
+{
+    float result = FastExp2F(exponent * FastLog2F(base));
+    return result;
+}
+
 // simple functions
 
 float SinF(float radians)
@@ -127,6 +321,16 @@ float CosF(float radians)
     return result;
 }
 
+void SinCosF(float radians, float *sin_out, float *cos_out)
+{
+#if WM_MATH_FAST
+    FastSinCosF(radians, sin_out, cos_out);
+#else
+    *sin_out = SINF(radians);
+    *cos_out = COSF(radians);
+#endif
+}
+
 float TanF(float radians)
 {
     float result = TANF(radians);
@@ -163,6 +367,22 @@ float LogF(float x)
     return result;
 }
 
+float Exp2F(float x)
+{
+#if WM_MATH_FAST
+    float result = FastExp2F(x);
+#else
+    float result = EXP2F(x);
+#endif
+    return result;
+}
+
+float Log2F(float x)
+{
+    float result = LOG2F(x);
+    return result;
+}
+
 float SquareRootF(float x)
 {
     float result = SQRTF(x);
@@ -304,10 +524,14 @@ vec3 AddVec3(vec3 a, vec3 b)
 vec4 AddVec4(vec4 a, vec4 b)
 {
     vec4 result;
+#if WM_MATH_SSE
+    result.sse = _mm_add_ps(a.sse, b.sse);
+#else
     result.x = a.x + b.x;
     result.y = a.y + b.y;
     result.z = a.z + b.z;
     result.w = a.w + b.w;
+#endif
     return result;
 }
 
@@ -331,10 +555,14 @@ vec3 SubtractVec3(vec3 a, vec3 b)
 vec4 SubtractVec4(vec4 a, vec4 b)
 {
     vec4 result;
+#if WM_MATH_SSE
+    result.sse = _mm_sub_ps(a.sse, b.sse);
+#else
     result.x = a.x - b.x;
     result.y = a.y - b.y;
     result.z = a.z - b.z;
     result.w = a.w - b.w;
+#endif
     return result;
 }
 
@@ -375,20 +603,28 @@ vec3 MultiplyVec3f(vec3 a, float b)
 vec4 MultiplyVec4(vec4 a, vec4 b)
 {
     vec4 result;
+#if WM_MATH_SSE
+    result.sse = _mm_mul_ps(a.sse, b.sse);
+#else
     result.x = a.x * b.x;
     result.y = a.y * b.y;
     result.z = a.z * b.z;
     result.w = a.w * b.w;
+#endif
     return result;
 }
 
 vec4 MultiplyVec4f(vec4 a, float b)
 {
     vec4 result;
+#if WM_MATH_SSE
+    result.sse = _mm_mul_ps(a.sse, _mm_set1_ps(b));
+#else
     result.x = a.x * b;
     result.y = a.y * b;
     result.z = a.z * b;
     result.w = a.w * b;
+#endif
     return result;
 }
 
@@ -429,20 +665,28 @@ vec3 DivideVec3f(vec3 a, float b)
 vec4 DivideVec4(vec4 a, vec4 b)
 {
     vec4 result;
+#if WM_MATH_SSE
+    result.sse = _mm_div_ps(a.sse, b.sse);
+#else
     result.x = a.x / b.x;
     result.y = a.y / b.y;
     result.z = a.z / b.z;
     result.w = a.w / b.w;
+#endif
     return result;
 }
 
 vec4 DivideVec4f(vec4 a, float b)
 {
     vec4 result;
+#if WM_MATH_SSE
+    result.sse = _mm_div_ps(a.sse, _mm_set1_ps(b));
+#else
     result.x = a.x / b;
     result.y = a.y / b;
     result.z = a.z / b;
     result.w = a.w / b;
+#endif
     return result;
 }
 
@@ -556,7 +800,210 @@ vec4 NormalizeVec4(vec4 a)
     return result;
 }
 
+vec3 LerpVec3(vec3 a, float t, vec3 b)
+{
+    vec3 result;
+    result.x = Lerp(a.x, t, b.x);
+    result.y = Lerp(a.y, t, b.y);
+    result.z = Lerp(a.z, t, b.z);
+    return result;
+}
+
+// quaternion functions
+
+quat Quat(float x, float y, float z, float w)
+{
+    quat result;
+    result.x = x;
+    result.y = y;
+    result.z = z;
+    result.w = w;
+    return result;
+}
+
+quat QuatIdentity(void)
+{
+    quat result = Quat(0.0f, 0.0f, 0.0f, 1.0f);
+    return result;
+}
+
+quat QuatFromAxisAngle(float angle, vec3 axis)
+{
+    float half_angle = 0.5f * ToRadians(angle);
+    float sin_half, cos_half;
+    SinCosF(half_angle, &sin_half, &cos_half);
+    
+    float length_sq = LengthSquaredVec3(axis);
+    float axis_scale = (length_sq > 0.0f) ? sin_half * RSquareRootF(length_sq) : 0.0f;
+    
+    quat result;
+    result.xyz = MultiplyVec3f(axis, axis_scale);
+    result.w = cos_half;
+    return result;
+}
+
+// Rotation by b followed by rotation by a.
+quat MultiplyQuat(quat a, quat b)
+{
+    quat result;
+    result.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+    result.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+    result.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+    result.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+    return result;
+}
+
+quat ConjugateQuat(quat a)
+{
+    quat result = Quat(-a.x, -a.y, -a.z, a.w);
+    return result;
+}
+
+float DotQuat(quat a, quat b)
+{
+    float result = (a.x * b.x) + (a.y * b.y) + (a.z * b.z) + (a.w * b.w);
+    return result;
+}
+
+quat NormalizeQuat(quat a)
+{
+    quat result = QuatIdentity();
+    float length_sq = DotQuat(a, a);
+    if(length_sq != 0.0f)
+    {
+        float inverse_length = RSquareRootF(length_sq);
+        result = Quat(a.x * inverse_length, a.y * inverse_length,
+                      a.z * inverse_length, a.w * inverse_length);
+    }
+    return result;
+}
+
+// Normalizes quaternions stored as structure of arrays, like the
+// rotation part of TransformArrays.
+void NormalizeQuatArrays(float *x, float *y, float *z, float *w, int count)
+{
+    int idx = 0;
+#if WM_MATH_SSE
+    __m128 one = _mm_set1_ps(1.0f);
+    for(; idx + 4 <= count; idx += 4)
+    {
+        __m128 qx = _mm_loadu_ps(x + idx);
+        __m128 qy = _mm_loadu_ps(y + idx);
+        __m128 qz = _mm_loadu_ps(z + idx);
+        __m128 qw = _mm_loadu_ps(w + idx);
+        __m128 length_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)),
+                                      _mm_add_ps(_mm_mul_ps(qz, qz), _mm_mul_ps(qw, qw)));
+        __m128 inverse_length = _mm_div_ps(one, _mm_sqrt_ps(length_sq));
+        _mm_storeu_ps(x + idx, _mm_mul_ps(qx, inverse_length));
+        _mm_storeu_ps(y + idx, _mm_mul_ps(qy, inverse_length));
+        _mm_storeu_ps(z + idx, _mm_mul_ps(qz, inverse_length));
+        _mm_storeu_ps(w + idx, _mm_mul_ps(qw, inverse_length));
+    }
+#endif
+    for(; idx < count; ++idx)
+    {
+        quat normalized = NormalizeQuat(Quat(x[idx], y[idx], z[idx], w[idx]));
+        x[idx] = normalized.x;
+        y[idx] = normalized.y;
+        z[idx] = normalized.z;
+        w[idx] = normalized.w;
+    }
+}
+
+// Normalized linear interpolation, cheap and good enough when a and b are
+// close (like consecutive simulation states).
+quat NLerp(quat a, float t, quat b)
+{
+    // NOTE(sokus): q and -q are the same rotation, take the shorter arc.
+    float b_sign = (DotQuat(a, b) < 0.0f) ? -1.0f : 1.0f;
+    quat result;
+    result.x = Lerp(a.x, t, b_sign * b.x);
+    result.y = Lerp(a.y, t, b_sign * b.y);
+    result.z = Lerp(a.z, t, b_sign * b.z);
+    result.w = Lerp(a.w, t, b_sign * b.w);
+    result = NormalizeQuat(result);
+    return result;
+}
+
+// Spherical linear interpolation, constant angular velocity.
+quat SLerp(quat a, float t, quat b)
+{
+    float cos_theta = DotQuat(a, b);
+    float b_sign = 1.0f;
+    if(cos_theta < 0.0f)
+    {
+        cos_theta = -cos_theta;
+        b_sign = -1.0f;
+    }
+    
+    quat result;
+    if(cos_theta > 0.9995f)
+    {
+        // NOTE(sokus): sin(theta) gets too close to 0, nlerp is accurate here.
+        result = NLerp(a, t, b);
+    }
+    else
+    {
+        float theta = ACosF(cos_theta);
+        float inverse_sin_theta = 1.0f / SinF(theta);
+        float a_weight = SinF((1.0f - t) * theta) * inverse_sin_theta;
+        float b_weight = SinF(t * theta) * inverse_sin_theta * b_sign;
+        result.x = a_weight * a.x + b_weight * b.x;
+        result.y = a_weight * a.y + b_weight * b.y;
+        result.z = a_weight * a.z + b_weight * b.z;
+        result.w = a_weight * a.w + b_weight * b.w;
+    }
+    return result;
+}
+
+vec3 RotateVec3ByQuat(quat rotation, vec3 vector)
+{
+    // v' = v + w * t + cross(q.xyz, t), with t = 2 * cross(q.xyz, v)
+    vec3 t = MultiplyVec3f(Cross(rotation.xyz, vector), 2.0f);
+    vec3 result = AddVec3(vector, MultiplyVec3f(t, rotation.w));
+    result = AddVec3(result, Cross(rotation.xyz, t));
+    return result;
+}
+
+mat3 Mat3FromQuat(quat rotation)
+{
+    float x = rotation.x;
+    float y = rotation.y;
+    float z = rotation.z;
+    float w = rotation.w;
+    
+    mat3 result;
+    result.columns[0] = Vec3(1.0f - 2.0f * (y*y + z*z), 2.0f * (x*y + w*z), 2.0f * (x*z - w*y));
+    result.columns[1] = Vec3(2.0f * (x*y - w*z), 1.0f - 2.0f * (x*x + z*z), 2.0f * (y*z + w*x));
+    result.columns[2] = Vec3(2.0f * (x*z + w*y), 2.0f * (y*z - w*x), 1.0f - 2.0f * (x*x + y*y));
+    return result;
+}
+
 // matrix functions
+mat3 Mat3(void)
+{
+    mat3 result = {0};
+    return result;
+}
+
+mat3 Mat3d(float diagonal)
+{
+    mat3 result = Mat3();
+    result.elements[0][0] = diagonal;
+    result.elements[1][1] = diagonal;
+    result.elements[2][2] = diagonal;
+    return result;
+}
+
+mat3 Mat3FromMat4(mat4 matrix)
+{
+    mat3 result;
+    result.columns[0] = matrix.columns[0].xyz;
+    result.columns[1] = matrix.columns[1].xyz;
+    result.columns[2] = matrix.columns[2].xyz;
+    return result;
+}
+
 mat4 Mat4(void)
 {
     mat4 result = {0};
@@ -573,7 +1020,7 @@ mat4 Mat4d(float diagonal)
     return result;
 }
 
-mat4 Transpose(mat4 matrix)
+mat4 TransposeScalar(mat4 matrix)
 {
     mat4 result;
     for(int col_idx = 0; col_idx < 4; ++col_idx)
@@ -586,7 +1033,7 @@ mat4 Transpose(mat4 matrix)
     return result;
 }
 
-mat4 AddMat4(mat4 a, mat4 b)
+mat4 AddMat4Scalar(mat4 a, mat4 b)
 {
     mat4 result;
     for(int col_idx = 0; col_idx < 4; ++col_idx)
@@ -600,7 +1047,7 @@ mat4 AddMat4(mat4 a, mat4 b)
     return result;
 }
 
-mat4 SubtractMat4(mat4 a, mat4 b)
+mat4 SubtractMat4Scalar(mat4 a, mat4 b)
 {
     mat4 result;
     for(int col_idx = 0; col_idx < 4; ++col_idx)
@@ -614,7 +1061,7 @@ mat4 SubtractMat4(mat4 a, mat4 b)
     return result;
 }
 
-mat4 MultiplyMat4(mat4 a, mat4 b)
+mat4 MultiplyMat4Scalar(mat4 a, mat4 b)
 {
     mat4 result;
     for(int col_idx = 0; col_idx < 4; ++col_idx)
@@ -632,7 +1079,7 @@ mat4 MultiplyMat4(mat4 a, mat4 b)
     return result;
 }
 
-mat4 MultiplyMat4f(mat4 a, float b)
+mat4 MultiplyMat4fScalar(mat4 a, float b)
 {
     mat4 result;
     for(int col_idx = 0; col_idx < 4; ++col_idx)
@@ -645,7 +1092,7 @@ mat4 MultiplyMat4f(mat4 a, float b)
     return result;
 }
 
-vec4 MultiplyMat4ByVec4(mat4 matrix, vec4 vector)
+vec4 MultiplyMat4ByVec4Scalar(mat4 matrix, vec4 vector)
 {
     vec4 result;
     for(int row_idx = 0; row_idx < 4; ++row_idx)
@@ -660,6 +1107,118 @@ vec4 MultiplyMat4ByVec4(mat4 matrix, vec4 vector)
     return result;
 }
 
+// NOTE(sokus): The *Scalar versions above are the reference implementation,
+// the functions below use SIMD when it's available and fall back to them.
+
+mat4 Transpose(mat4 matrix)
+{
+#if WM_MATH_SSE
+    mat4 result = matrix;
+    _MM_TRANSPOSE4_PS(result.columns[0].sse, result.columns[1].sse,
+                      result.columns[2].sse, result.columns[3].sse);
+#else
+    mat4 result = TransposeScalar(matrix);
+#endif
+    return result;
+}
+
+mat4 AddMat4(mat4 a, mat4 b)
+{
+#if WM_MATH_SSE
+    mat4 result;
+    for(int col_idx = 0; col_idx < 4; ++col_idx)
+        result.columns[col_idx].sse = _mm_add_ps(a.columns[col_idx].sse, b.columns[col_idx].sse);
+#else
+    mat4 result = AddMat4Scalar(a, b);
+#endif
+    return result;
+}
+
+mat4 SubtractMat4(mat4 a, mat4 b)
+{
+#if WM_MATH_SSE
+    mat4 result;
+    for(int col_idx = 0; col_idx < 4; ++col_idx)
+        result.columns[col_idx].sse = _mm_sub_ps(a.columns[col_idx].sse, b.columns[col_idx].sse);
+#else
+    mat4 result = SubtractMat4Scalar(a, b);
+#endif
+    return result;
+}
+
+#if WM_MATH_SSE
+// Linear combination of the columns of a matrix, weighted by the components
+// of a vector. Summed in the same order as the scalar loops.
+__m128 LinearCombineSSE(__m128 vector, mat4 *matrix)
+{
+    __m128 result = _mm_mul_ps(_mm_shuffle_ps(vector, vector, 0x00), matrix->columns[0].sse);
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(vector, vector, 0x55), matrix->columns[1].sse));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(vector, vector, 0xaa), matrix->columns[2].sse));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(vector, vector, 0xff), matrix->columns[3].sse));
+    return result;
+}
+#endif
+
+#if WM_MATH_AVX
+// Same as above but for two vectors at once, one per 128-bit lane.
+__m256 LinearCombineAVX(__m256 vectors, mat4 *matrix)
+{
+    __m256 column0 = _mm256_broadcast_ps(&matrix->columns[0].sse);
+    __m256 column1 = _mm256_broadcast_ps(&matrix->columns[1].sse);
+    __m256 column2 = _mm256_broadcast_ps(&matrix->columns[2].sse);
+    __m256 column3 = _mm256_broadcast_ps(&matrix->columns[3].sse);
+    __m256 result = _mm256_mul_ps(_mm256_permute_ps(vectors, 0x00), column0);
+    result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(vectors, 0x55), column1));
+    result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(vectors, 0xaa), column2));
+    result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(vectors, 0xff), column3));
+    return result;
+}
+#endif
+
+mat4 MultiplyMat4(mat4 a, mat4 b)
+{
+#if WM_MATH_AVX
+    mat4 result;
+    __m256 b_columns01 = _mm256_load_ps(&b.elements[0][0]);
+    __m256 b_columns23 = _mm256_load_ps(&b.elements[2][0]);
+    _mm256_store_ps(&result.elements[0][0], LinearCombineAVX(b_columns01, &a));
+    _mm256_store_ps(&result.elements[2][0], LinearCombineAVX(b_columns23, &a));
+#elif WM_MATH_SSE
+    mat4 result;
+    result.columns[0].sse = LinearCombineSSE(b.columns[0].sse, &a);
+    result.columns[1].sse = LinearCombineSSE(b.columns[1].sse, &a);
+    result.columns[2].sse = LinearCombineSSE(b.columns[2].sse, &a);
+    result.columns[3].sse = LinearCombineSSE(b.columns[3].sse, &a);
+#else
+    mat4 result = MultiplyMat4Scalar(a, b);
+#endif
+    return result;
+}
+
+mat4 MultiplyMat4f(mat4 a, float b)
+{
+#if WM_MATH_SSE
+    mat4 result;
+    __m128 scalar = _mm_set1_ps(b);
+    for(int col_idx = 0; col_idx < 4; ++col_idx)
+        result.columns[col_idx].sse = _mm_mul_ps(a.columns[col_idx].sse, scalar);
+#else
+    mat4 result = MultiplyMat4fScalar(a, b);
+#endif
+    return result;
+}
+
+vec4 MultiplyMat4ByVec4(mat4 matrix, vec4 vector)
+{
+#if WM_MATH_SSE
+    vec4 result;
+    result.sse = LinearCombineSSE(vector.sse, &matrix);
+#else
+    vec4 result = MultiplyMat4ByVec4Scalar(matrix, vector);
+#endif
+    return result;
+}
+
 mat4 DivideMat4f(mat4 a, float b)
 {
     mat4 result;
@@ -673,6 +1232,69 @@ mat4 DivideMat4f(mat4 a, float b)
     return result;
 }
 
+mat4 InverseMat4(mat4 matrix)
+{
+    // NOTE(sokus): Columns are split into their xyz part and w component,
+    // the 2x2 sub-determinants then come out of cross products.
+    vec3 a = matrix.columns[0].xyz;
+    vec3 b = matrix.columns[1].xyz;
+    vec3 c = matrix.columns[2].xyz;
+    vec3 d = matrix.columns[3].xyz;
+    float x = matrix.elements[0][3];
+    float y = matrix.elements[1][3];
+    float z = matrix.elements[2][3];
+    float w = matrix.elements[3][3];
+    
+    vec3 s = Cross(a, b);
+    vec3 t = Cross(c, d);
+    vec3 u = SubtractVec3(MultiplyVec3f(a, y), MultiplyVec3f(b, x));
+    vec3 v = SubtractVec3(MultiplyVec3f(c, w), MultiplyVec3f(d, z));
+    
+    float inverse_determinant = 1.0f / (DotVec3(s, v) + DotVec3(t, u));
+    s = MultiplyVec3f(s, inverse_determinant);
+    t = MultiplyVec3f(t, inverse_determinant);
+    u = MultiplyVec3f(u, inverse_determinant);
+    v = MultiplyVec3f(v, inverse_determinant);
+    
+    vec3 row0 = AddVec3(Cross(b, v), MultiplyVec3f(t, y));
+    vec3 row1 = SubtractVec3(Cross(v, a), MultiplyVec3f(t, x));
+    vec3 row2 = AddVec3(Cross(d, u), MultiplyVec3f(s, w));
+    vec3 row3 = SubtractVec3(Cross(u, c), MultiplyVec3f(s, z));
+    
+    mat4 result;
+    result.columns[0] = Vec4(row0.x, row1.x, row2.x, row3.x);
+    result.columns[1] = Vec4(row0.y, row1.y, row2.y, row3.y);
+    result.columns[2] = Vec4(row0.z, row1.z, row2.z, row3.z);
+    result.columns[3] = Vec4(-DotVec3(b, t), DotVec3(a, t), -DotVec3(d, s), DotVec3(c, s));
+    return result;
+}
+
+// Inverse transpose of the upper 3x3 part, this is the matrix that
+// transforms normals when the matrix has non-uniform scale.
+mat3 InverseTransposeMat3(mat4 matrix)
+{
+    vec3 a = matrix.columns[0].xyz;
+    vec3 b = matrix.columns[1].xyz;
+    vec3 c = matrix.columns[2].xyz;
+    
+    vec3 b_cross_c = Cross(b, c);
+    float inverse_determinant = 1.0f / DotVec3(a, b_cross_c);
+    
+    mat3 result;
+    result.columns[0] = MultiplyVec3f(b_cross_c, inverse_determinant);
+    result.columns[1] = MultiplyVec3f(Cross(c, a), inverse_determinant);
+    result.columns[2] = MultiplyVec3f(Cross(a, b), inverse_determinant);
+    return result;
+}
+
+vec3 MultiplyMat3ByVec3(mat3 matrix, vec3 vector)
+{
+    vec3 result = MultiplyVec3f(matrix.columns[0], vector.x);
+    result = AddVec3(result, MultiplyVec3f(matrix.columns[1], vector.y));
+    result = AddVec3(result, MultiplyVec3f(matrix.columns[2], vector.z));
+    return result;
+}
+
 // common graphics transformations
 
 mat4 Orthographic(float left, float right, float bottom, float top, float near, float far)
@@ -705,14 +1327,20 @@ mat4 Perspective(float fov, float aspect_ratio, float near, float far)
     return result;
 }
 
+// NOTE(sokus): Translate, Rotate and Scale only touch the rows that the
+// left-hand transformation actually changes, instead of building a full
+// matrix and going through MultiplyMat4.
+
 mat4 Translate(mat4 matrix, float x, float y, float z)
 {
-    mat4 translate = Mat4d(1.0f);
-    translate.elements[3][0] = x;
-    translate.elements[3][1] = y;
-    translate.elements[3][2] = z;
-    
-    mat4 result = MultiplyMat4(translate, matrix);
+    mat4 result = matrix;
+    for(int col_idx = 0; col_idx < 4; ++col_idx)
+    {
+        float w = matrix.elements[col_idx][3];
+        result.elements[col_idx][0] += x * w;
+        result.elements[col_idx][1] += y * w;
+        result.elements[col_idx][2] += z * w;
+    }
     return result;
 }
 
@@ -722,33 +1350,23 @@ mat4 TranslateVec3(mat4 matrix, vec3 translation)
     return result;
 }
 
+mat3 Mat3FromAxisAngle(float angle, float axis_x, float axis_y, float axis_z)
+{
+    quat rotation = QuatFromAxisAngle(angle, Vec3(axis_x, axis_y, axis_z));
+    mat3 result = Mat3FromQuat(rotation);
+    return result;
+}
+
 mat4 Rotate(mat4 matrix, float angle, float axis_x, float axis_y, float axis_z)
 {
-    mat4 rotate = Mat4d(1.0f);
-    
-    float mag_sq = SQUARE(axis_x) + SQUARE(axis_y) + SQUARE(axis_z);
-    float mag = SQRTF(mag_sq);
-    float axis_x_n = (mag > 0.0f) ? axis_x / SQRTF(mag) : axis_x;
-    float axis_y_n = (mag > 0.0f) ? axis_y / SQRTF(mag) : axis_y;
-    float axis_z_n = (mag > 0.0f) ? axis_z / SQRTF(mag) : axis_z;
-    
-    float sin_theta = SinF(ToRadians(angle));
-    float cos_theta = CosF(ToRadians(angle));
-    float cos_value = 1.0f - cos_theta;
-    
-    rotate.elements[0][0] = (axis_x_n * axis_x_n * cos_value) + cos_theta;
-    rotate.elements[0][1] = (axis_x_n * axis_y_n * cos_value) + (axis_z_n * sin_theta);
-    rotate.elements[0][2] = (axis_x_n * axis_z_n * cos_value) - (axis_y_n * sin_theta);
+    mat3 rotate = Mat3FromAxisAngle(angle, axis_x, axis_y, axis_z);
     
-    rotate.elements[1][0] = (axis_y_n * axis_x_n * cos_value) - (axis_z_n * sin_theta);
-    rotate.elements[1][1] = (axis_y_n * axis_y_n * cos_value) + cos_theta;
-    rotate.elements[1][2] = (axis_y_n * axis_z_n * cos_value) + (axis_x_n * sin_theta);
-    
-    rotate.elements[2][0] = (axis_z_n * axis_x_n * cos_value) + (axis_y_n * sin_theta);
-    rotate.elements[2][1] = (axis_z_n * axis_y_n * cos_value) - (axis_x_n * sin_theta);
-    rotate.elements[2][2] = (axis_z_n * axis_z_n * cos_value) + cos_theta;
-    
-    mat4 result = MultiplyMat4(rotate, matrix);
+    mat4 result;
+    for(int col_idx = 0; col_idx < 4; ++col_idx)
+    {
+        vec3 rotated = MultiplyMat3ByVec3(rotate, matrix.columns[col_idx].xyz);
+        result.columns[col_idx] = Vec4v(rotated, matrix.elements[col_idx][3]);
+    }
     return result;
 }
 
@@ -760,12 +1378,13 @@ mat4 RotateVec3(mat4 matrix, float angle, vec3 axis)
 
 mat4 Scale(mat4 matrix, float x, float y, float z)
 {
-    mat4 scale = Mat4d(1.0f);
-    scale.elements[0][0] = x;
-    scale.elements[1][1] = y;
-    scale.elements[2][2] = z;
-    
-    mat4 result = MultiplyMat4(scale, matrix);
+    mat4 result = matrix;
+    for(int col_idx = 0; col_idx < 4; ++col_idx)
+    {
+        result.elements[col_idx][0] *= x;
+        result.elements[col_idx][1] *= y;
+        result.elements[col_idx][2] *= z;
+    }
     return result;
 }
 
@@ -805,4 +1424,475 @@ mat4 LookAt(vec3 eye, vec3 center, vec3 up)
     return result;
 }
 
+
+// affine transformations
+// NOTE(sokus): These assume the last row is (0, 0, 0, 1), which holds for
+// anything built out of translations, rotations and scales.
+
+mat4 Mat4FromMat3(mat3 matrix, vec3 translation)
+{
+    mat4 result;
+    result.columns[0] = Vec4v(matrix.columns[0], 0.0f);
+    result.columns[1] = Vec4v(matrix.columns[1], 0.0f);
+    result.columns[2] = Vec4v(matrix.columns[2], 0.0f);
+    result.columns[3] = Vec4v(translation, 1.0f);
+    return result;
+}
+
+mat4 Mat4FromTranslation(vec3 translation)
+{
+    mat4 result = Mat4d(1.0f);
+    result.columns[3] = Vec4v(translation, 1.0f);
+    return result;
+}
+
+mat4 Mat4FromScale(vec3 scale)
+{
+    mat4 result = Mat4();
+    result.elements[0][0] = scale.x;
+    result.elements[1][1] = scale.y;
+    result.elements[2][2] = scale.z;
+    result.elements[3][3] = 1.0f;
+    return result;
+}
+
+mat4 Mat4FromRotation(float angle, vec3 axis)
+{
+    mat3 rotation = Mat3FromAxisAngle(angle, axis.x, axis.y, axis.z);
+    mat4 result = Mat4FromMat3(rotation, Vec3(0.0f, 0.0f, 0.0f));
+    return result;
+}
+
+// translation * rotation * scale, same as Translate(Rotate(Scale(Mat4d(1))))
+mat4 Mat4FromTRS(vec3 translation, float angle, vec3 axis, vec3 scale)
+{
+    mat3 rotation = Mat3FromAxisAngle(angle, axis.x, axis.y, axis.z);
+    rotation.columns[0] = MultiplyVec3f(rotation.columns[0], scale.x);
+    rotation.columns[1] = MultiplyVec3f(rotation.columns[1], scale.y);
+    rotation.columns[2] = MultiplyVec3f(rotation.columns[2], scale.z);
+    mat4 result = Mat4FromMat3(rotation, translation);
+    return result;
+}
+
+mat4 Mat4FromQuat(quat rotation)
+{
+    mat4 result = Mat4FromMat3(Mat3FromQuat(rotation), Vec3(0.0f, 0.0f, 0.0f));
+    return result;
+}
+
+mat4 Mat4FromTRSQuat(vec3 translation, quat rotation, vec3 scale)
+{
+    mat3 rotation_scale = Mat3FromQuat(rotation);
+    rotation_scale.columns[0] = MultiplyVec3f(rotation_scale.columns[0], scale.x);
+    rotation_scale.columns[1] = MultiplyVec3f(rotation_scale.columns[1], scale.y);
+    rotation_scale.columns[2] = MultiplyVec3f(rotation_scale.columns[2], scale.z);
+    mat4 result = Mat4FromMat3(rotation_scale, translation);
+    return result;
+}
+
+#if WM_MATH_SSE
+// Same as LinearCombineSSE but only over the first three columns, what's
+// left of a product with an affine matrix once w = 0 is taken out.
+__m128 LinearCombine3SSE(__m128 vector, mat4 *matrix)
+{
+    __m128 result = _mm_mul_ps(_mm_shuffle_ps(vector, vector, 0x00), matrix->columns[0].sse);
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(vector, vector, 0x55), matrix->columns[1].sse));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(vector, vector, 0xaa), matrix->columns[2].sse));
+    return result;
+}
+
+// a x b, the w component comes out as 0.
+__m128 CrossSSE(__m128 a, __m128 b)
+{
+    // NOTE(sokus): a * b.yzx - a.yzx * b is the cross product in zxy order.
+    __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 result = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+    result = _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1));
+    return result;
+}
+#endif
+
+#if WM_MATH_AVX
+__m256 LinearCombine3AVX(__m256 vectors, mat4 *matrix)
+{
+    __m256 column0 = _mm256_broadcast_ps(&matrix->columns[0].sse);
+    __m256 column1 = _mm256_broadcast_ps(&matrix->columns[1].sse);
+    __m256 column2 = _mm256_broadcast_ps(&matrix->columns[2].sse);
+    __m256 result = _mm256_mul_ps(_mm256_permute_ps(vectors, 0x00), column0);
+    result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(vectors, 0x55), column1));
+    result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(vectors, 0xaa), column2));
+    return result;
+}
+#endif
+
+// NOTE(sokus): The first three columns of b have w = 0 and the last one has
+// w = 1, so every column is a combination of a's first three columns and
+// a's translation only gets added to the last one. 12 multiplies instead
+// of 16.
+mat4 MultiplyAffine(mat4 a, mat4 b)
+{
+    mat4 result;
+#if WM_MATH_AVX
+    __m256 b_columns01 = _mm256_load_ps(&b.elements[0][0]);
+    __m256 b_columns23 = _mm256_load_ps(&b.elements[2][0]);
+    __m256 translation = _mm256_insertf128_ps(_mm256_setzero_ps(), a.columns[3].sse, 1);
+    _mm256_store_ps(&result.elements[0][0], LinearCombine3AVX(b_columns01, &a));
+    _mm256_store_ps(&result.elements[2][0], _mm256_add_ps(LinearCombine3AVX(b_columns23, &a), translation));
+#elif WM_MATH_SSE
+    result.columns[0].sse = LinearCombine3SSE(b.columns[0].sse, &a);
+    result.columns[1].sse = LinearCombine3SSE(b.columns[1].sse, &a);
+    result.columns[2].sse = LinearCombine3SSE(b.columns[2].sse, &a);
+    result.columns[3].sse = _mm_add_ps(LinearCombine3SSE(b.columns[3].sse, &a), a.columns[3].sse);
+#else
+    for(int col_idx = 0; col_idx < 4; ++col_idx)
+    {
+        for(int row_idx = 0; row_idx < 3; ++row_idx)
+        {
+            result.elements[col_idx][row_idx] = (a.elements[0][row_idx] * b.elements[col_idx][0] +
+                                                 a.elements[1][row_idx] * b.elements[col_idx][1] +
+                                                 a.elements[2][row_idx] * b.elements[col_idx][2]);
+        }
+        result.elements[col_idx][3] = 0.0f;
+    }
+    result.elements[3][0] += a.elements[3][0];
+    result.elements[3][1] += a.elements[3][1];
+    result.elements[3][2] += a.elements[3][2];
+    result.elements[3][3] = 1.0f;
+#endif
+    return result;
+}
+
+mat4 InverseAffine(mat4 matrix)
+{
+    mat4 result;
+#if WM_MATH_SSE
+    // NOTE(sokus): Rows of the inverse 3x3 are the cross products of the
+    // columns over the determinant, transposed into columns in registers.
+    // The translation then goes through the inverse, negated.
+    __m128 a = matrix.columns[0].sse;
+    __m128 b = matrix.columns[1].sse;
+    __m128 c = matrix.columns[2].sse;
+    __m128 row0 = CrossSSE(b, c);
+    __m128 row1 = CrossSSE(c, a);
+    __m128 row2 = CrossSSE(a, b);
+    __m128 row3 = _mm_setzero_ps();
+    
+    __m128 products = _mm_mul_ps(a, row0);
+    __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_shuffle_ps(products, products, 0x00),
+                                               _mm_shuffle_ps(products, products, 0x55)),
+                                    _mm_shuffle_ps(products, products, 0xaa));
+    __m128 inverse_determinant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+    row0 = _mm_mul_ps(row0, inverse_determinant);
+    row1 = _mm_mul_ps(row1, inverse_determinant);
+    row2 = _mm_mul_ps(row2, inverse_determinant);
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+    
+    result.columns[0].sse = row0;
+    result.columns[1].sse = row1;
+    result.columns[2].sse = row2;
+    result.columns[3].sse = _mm_sub_ps(_mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f),
+                                       LinearCombine3SSE(matrix.columns[3].sse, &result));
+#else
+    // NOTE(sokus): inverse(M) = transpose(inverse_transpose(M)), so the
+    // rows of the inverse are the columns of InverseTransposeMat3.
+    mat3 inverse_transpose = InverseTransposeMat3(matrix);
+    vec3 row0 = inverse_transpose.columns[0];
+    vec3 row1 = inverse_transpose.columns[1];
+    vec3 row2 = inverse_transpose.columns[2];
+    vec3 translation = matrix.columns[3].xyz;
+    
+    result.columns[0] = Vec4(row0.x, row1.x, row2.x, 0.0f);
+    result.columns[1] = Vec4(row0.y, row1.y, row2.y, 0.0f);
+    result.columns[2] = Vec4(row0.z, row1.z, row2.z, 0.0f);
+    result.columns[3] = Vec4(-DotVec3(row0, translation),
+                             -DotVec3(row1, translation),
+                             -DotVec3(row2, translation),
+                             1.0f);
+#endif
+    return result;
+}
+
+// NOTE(sokus): View and model matrices are both affine, the projection
+// isn't, so only the model view gets the shortcut.
+mat4 ModelView(mat4 view, mat4 model)
+{
+    mat4 result = MultiplyAffine(view, model);
+    return result;
+}
+
+mat4 ModelViewProjection(mat4 view_projection, mat4 model)
+{
+    mat4 result = MultiplyMat4(view_projection, model);
+    return result;
+}
+
+// Camera to world transformation, the inverse of LookAt with the same arguments.
+mat4 InverseLookAt(vec3 eye, vec3 center, vec3 up)
+{
+    vec3 f = NormalizeVec3(SubtractVec3(center, eye));
+    vec3 s = NormalizeVec3(Cross(f, up));
+    vec3 u = Cross(s, f);
+    
+    mat4 result;
+    result.columns[0] = Vec4v(s, 0.0f);
+    result.columns[1] = Vec4v(u, 0.0f);
+    result.columns[2] = Vec4(-f.x, -f.y, -f.z, 0.0f);
+    result.columns[3] = Vec4v(eye, 1.0f);
+    return result;
+}
+
+// Inverse of Perspective with the same arguments, only the five non-zero
+// elements need inverting.
+mat4 InversePerspective(float fov, float aspect_ratio, float near, float far)
+{
+    mat4 result = Mat4();
+    
+    float tangent = TanF(fov * (PI32 / 360.0f));
+    result.elements[0][0] = tangent * aspect_ratio;
+    result.elements[1][1] = tangent;
+    result.elements[2][3] = (near - far) / (2.0f * near * far);
+    result.elements[3][2] = -1.0f;
+    result.elements[3][3] = (near + far) / (2.0f * near * far);
+    
+    return result;
+}
+
+// frustum culling
+
+// Planes point inwards, (a, b, c) is normalized so the plane equation
+// gives the signed distance.
+typedef struct Frustum
+{
+    vec4 planes[6];
+} Frustum;
+
+// Extracts the planes of the clip volume of a (view) projection matrix,
+// in the space the matrix transforms from.
+Frustum FrustumFromMatrix(mat4 matrix)
+{
+    vec4 rows[4];
+    for(int row_idx = 0; row_idx < 4; ++row_idx)
+    {
+        rows[row_idx] = Vec4(matrix.elements[0][row_idx], matrix.elements[1][row_idx],
+                             matrix.elements[2][row_idx], matrix.elements[3][row_idx]);
+    }
+    
+    Frustum result;
+    for(int axis_idx = 0; axis_idx < 3; ++axis_idx)
+    {
+        result.planes[2 * axis_idx + 0] = AddVec4(rows[3], rows[axis_idx]);
+        result.planes[2 * axis_idx + 1] = SubtractVec4(rows[3], rows[axis_idx]);
+    }
+    for(int plane_idx = 0; plane_idx < 6; ++plane_idx)
+    {
+        vec4 *plane = result.planes + plane_idx;
+        *plane = MultiplyVec4f(*plane, 1.0f / LengthVec3(plane->xyz));
+    }
+    return result;
+}
+
+bool SphereInFrustum(Frustum *frustum, vec3 center, float radius)
+{
+    bool result = true;
+    for(int plane_idx = 0; result && plane_idx < 6; ++plane_idx)
+    {
+        vec4 plane = frustum->planes[plane_idx];
+        result = (DotVec3(plane.xyz, center) + plane.w >= -radius);
+    }
+    return result;
+}
+
+// batch transformations
+
+// Structure-of-arrays input for the batch kernels. Rotation is a unit
+// quaternion (x, y, z, w), the model matrix is translation * rotation * scale.
+typedef struct TransformArrays
+{
+    float *position_x;
+    float *position_y;
+    float *position_z;
+    
+    float *rotation_x;
+    float *rotation_y;
+    float *rotation_z;
+    float *rotation_w;
+    
+    float *scale_x;
+    float *scale_y;
+    float *scale_z;
+} TransformArrays;
+
+// NOTE(sokus): Matrices are read and written with a byte stride so the
+// kernels can fill interleaved data (like an instance buffer) in place. The
+// stride only has to keep floats aligned, so strided matrices are never
+// accessed through a mat4 (which is 16 byte aligned), only as floats with
+// unaligned loads and stores.
+#define STRIDED_FLOATS(base, stride, index) ((float *)((char *)(base) + (size_t)(index) * (stride)))
+
+mat4 LoadStridedMat4(void *base, size_t stride, int index)
+{
+    float *elements = STRIDED_FLOATS(base, stride, index);
+    mat4 result;
+    for(int col_idx = 0; col_idx < 4; ++col_idx)
+        for(int row_idx = 0; row_idx < 4; ++row_idx)
+            result.elements[col_idx][row_idx] = elements[col_idx * 4 + row_idx];
+    return result;
+}
+
+void StoreStridedMat4(void *base, size_t stride, int index, mat4 matrix)
+{
+    float *elements = STRIDED_FLOATS(base, stride, index);
+    for(int col_idx = 0; col_idx < 4; ++col_idx)
+        for(int row_idx = 0; row_idx < 4; ++row_idx)
+            elements[col_idx * 4 + row_idx] = matrix.elements[col_idx][row_idx];
+}
+
+void ComposeModelMatricesScalar(TransformArrays *transforms, int first, int count,
+                                void *out, size_t out_stride)
+{
+    for(int idx = 0; idx < count; ++idx)
+    {
+        int src_idx = first + idx;
+        float x = transforms->rotation_x[src_idx];
+        float y = transforms->rotation_y[src_idx];
+        float z = transforms->rotation_z[src_idx];
+        float w = transforms->rotation_w[src_idx];
+        float sx = transforms->scale_x[src_idx];
+        float sy = transforms->scale_y[src_idx];
+        float sz = transforms->scale_z[src_idx];
+        
+        float *result = STRIDED_FLOATS(out, out_stride, idx);
+        result[0] = (1.0f - 2.0f * (y*y + z*z)) * sx;
+        result[1] = 2.0f * (x*y + w*z) * sx;
+        result[2] = 2.0f * (x*z - w*y) * sx;
+        result[3] = 0.0f;
+        result[4] = 2.0f * (x*y - w*z) * sy;
+        result[5] = (1.0f - 2.0f * (x*x + z*z)) * sy;
+        result[6] = 2.0f * (y*z + w*x) * sy;
+        result[7] = 0.0f;
+        result[8] = 2.0f * (x*z + w*y) * sz;
+        result[9] = 2.0f * (y*z - w*x) * sz;
+        result[10] = (1.0f - 2.0f * (x*x + y*y)) * sz;
+        result[11] = 0.0f;
+        result[12] = transforms->position_x[src_idx];
+        result[13] = transforms->position_y[src_idx];
+        result[14] = transforms->position_z[src_idx];
+        result[15] = 1.0f;
+    }
+}
+
+void ComposeModelMatrices(TransformArrays *transforms, int first, int count,
+                          void *out, size_t out_stride)
+{
+    int idx = 0;
+#if WM_MATH_SSE
+    // NOTE(sokus): 4 transforms per iteration, every register holds the same
+    // matrix element of 4 different transforms. They get transposed back
+    // into columns right before the store.
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 two = _mm_set1_ps(2.0f);
+    __m128 zero = _mm_setzero_ps();
+    for(; idx + 4 <= count; idx += 4)
+    {
+        int src_idx = first + idx;
+        __m128 x = _mm_loadu_ps(transforms->rotation_x + src_idx);
+        __m128 y = _mm_loadu_ps(transforms->rotation_y + src_idx);
+        __m128 z = _mm_loadu_ps(transforms->rotation_z + src_idx);
+        __m128 w = _mm_loadu_ps(transforms->rotation_w + src_idx);
+        __m128 sx = _mm_loadu_ps(transforms->scale_x + src_idx);
+        __m128 sy = _mm_loadu_ps(transforms->scale_y + src_idx);
+        __m128 sz = _mm_loadu_ps(transforms->scale_z + src_idx);
+        
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+        
+        __m128 m00 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+        __m128 m01 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+        __m128 m02 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+        __m128 m10 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+        __m128 m11 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+        __m128 m12 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+        __m128 m20 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+        __m128 m21 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+        __m128 m22 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+        __m128 m30 = _mm_loadu_ps(transforms->position_x + src_idx);
+        __m128 m31 = _mm_loadu_ps(transforms->position_y + src_idx);
+        __m128 m32 = _mm_loadu_ps(transforms->position_z + src_idx);
+        __m128 m03 = zero, m13 = zero, m23 = zero, m33 = one;
+        
+        _MM_TRANSPOSE4_PS(m00, m01, m02, m03);
+        _MM_TRANSPOSE4_PS(m10, m11, m12, m13);
+        _MM_TRANSPOSE4_PS(m20, m21, m22, m23);
+        _MM_TRANSPOSE4_PS(m30, m31, m32, m33);
+        
+        float *out0 = STRIDED_FLOATS(out, out_stride, idx + 0);
+        float *out1 = STRIDED_FLOATS(out, out_stride, idx + 1);
+        float *out2 = STRIDED_FLOATS(out, out_stride, idx + 2);
+        float *out3 = STRIDED_FLOATS(out, out_stride, idx + 3);
+        _mm_storeu_ps(out0 + 0, m00); _mm_storeu_ps(out0 + 4, m10); _mm_storeu_ps(out0 + 8, m20); _mm_storeu_ps(out0 + 12, m30);
+        _mm_storeu_ps(out1 + 0, m01); _mm_storeu_ps(out1 + 4, m11); _mm_storeu_ps(out1 + 8, m21); _mm_storeu_ps(out1 + 12, m31);
+        _mm_storeu_ps(out2 + 0, m02); _mm_storeu_ps(out2 + 4, m12); _mm_storeu_ps(out2 + 8, m22); _mm_storeu_ps(out2 + 12, m32);
+        _mm_storeu_ps(out3 + 0, m03); _mm_storeu_ps(out3 + 4, m13); _mm_storeu_ps(out3 + 8, m23); _mm_storeu_ps(out3 + 12, m33);
+    }
+#endif
+    
+    if(idx < count)
+    {
+        ComposeModelMatricesScalar(transforms, first + idx, count - idx,
+                                   STRIDED_FLOATS(out, out_stride, idx), out_stride);
+    }
+}
+
+// out[i] = left * in[i], in and out are allowed to point to the same data.
+void MultiplyMat4Batch(mat4 *left, void *in, size_t in_stride,
+                       void *out, size_t out_stride, int count)
+{
+    for(int idx = 0; idx < count; ++idx)
+    {
+#if WM_MATH_SSE
+        float *right = STRIDED_FLOATS(in, in_stride, idx);
+        float *result = STRIDED_FLOATS(out, out_stride, idx);
+        __m128 column0 = LinearCombineSSE(_mm_loadu_ps(right + 0), left);
+        __m128 column1 = LinearCombineSSE(_mm_loadu_ps(right + 4), left);
+        __m128 column2 = LinearCombineSSE(_mm_loadu_ps(right + 8), left);
+        __m128 column3 = LinearCombineSSE(_mm_loadu_ps(right + 12), left);
+        _mm_storeu_ps(result + 0, column0);
+        _mm_storeu_ps(result + 4, column1);
+        _mm_storeu_ps(result + 8, column2);
+        _mm_storeu_ps(result + 12, column3);
+#else
+        mat4 right = LoadStridedMat4(in, in_stride, idx);
+        StoreStridedMat4(out, out_stride, idx, MultiplyMat4Scalar(*left, right));
+#endif
+    }
+}
+
+// out[i] = left * in[i] for affine matrices, see MultiplyAffine. in and out
+// are allowed to point to the same data.
+void MultiplyAffineBatch(mat4 *left, void *in, size_t in_stride,
+                         void *out, size_t out_stride, int count)
+{
+    for(int idx = 0; idx < count; ++idx)
+    {
+#if WM_MATH_SSE
+        float *right = STRIDED_FLOATS(in, in_stride, idx);
+        float *result = STRIDED_FLOATS(out, out_stride, idx);
+        __m128 column0 = LinearCombine3SSE(_mm_loadu_ps(right + 0), left);
+        __m128 column1 = LinearCombine3SSE(_mm_loadu_ps(right + 4), left);
+        __m128 column2 = LinearCombine3SSE(_mm_loadu_ps(right + 8), left);
+        __m128 column3 = _mm_add_ps(LinearCombine3SSE(_mm_loadu_ps(right + 12), left),
+                                    left->columns[3].sse);
+        _mm_storeu_ps(result + 0, column0);
+        _mm_storeu_ps(result + 4, column1);
+        _mm_storeu_ps(result + 8, column2);
+        _mm_storeu_ps(result + 12, column3);
+#else
+        mat4 right = LoadStridedMat4(in, in_stride, idx);
+        StoreStridedMat4(out, out_stride, idx, MultiplyAffine(*left, right));
+#endif
+    }
+}
+
 #endif //WM_MATH_H
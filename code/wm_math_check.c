@@ -0,0 +1,285 @@
+// Checks that the SIMD paths of wm_math.h agree with the *Scalar reference
+// functions, that the quaternion code agrees with rotation matrices built
+// independently of it, and that the TRS builders and fast inverses agree
+// with the generic transforms. Built and run by build.sh as
+// white-mage-math-check.out, exits with 1 when any of them is off by more
+// than the tolerance.
+
+#include "wm_helpers.h"
+#include "wm_math.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK_INPUT_COUNT 4096
+
+// Max difference allowed between the SIMD and scalar reference results.
+// The SIMD code sums in the same order as the scalar loops, whatever is
+// left comes from the compiler contracting the scalar code differently.
+#define CHECK_SIMD_TOLERANCE 1e-5
+
+// A * inverse(A) is compared against the identity, which carries the
+// rounding of the inverse itself.
+#define CHECK_INVERSE_TOLERANCE 1e-4
+
+// Rotations are compared against Check_AxisAngleMat4, which is computed in
+// double precision, so this is the float rounding of the code under test.
+#define CHECK_ROTATION_TOLERANCE 1e-5
+
+typedef struct CheckResult
+{
+    char *name;
+    double max_difference;
+    double tolerance;
+} CheckResult;
+
+float Check_RandomFloat(float min, float max)
+{
+    float t = (float)rand() / (float)RAND_MAX;
+    float result = min + t * (max - min);
+    return result;
+}
+
+mat4 Check_RandomMat4(void)
+{
+    mat4 result;
+    for(int col_idx = 0; col_idx < 4; ++col_idx)
+        for(int row_idx = 0; row_idx < 4; ++row_idx)
+            result.elements[col_idx][row_idx] = Check_RandomFloat(-2.0f, 2.0f);
+    return result;
+}
+
+// Rotation and scale well away from 0, so the inverse is well conditioned.
+mat4 Check_RandomAffine(void)
+{
+    vec3 translation = Vec3(Check_RandomFloat(-10.0f, 10.0f), Check_RandomFloat(-10.0f, 10.0f), Check_RandomFloat(-10.0f, 10.0f));
+    vec3 axis = Vec3(Check_RandomFloat(0.1f, 1.0f), Check_RandomFloat(-1.0f, 1.0f), Check_RandomFloat(-1.0f, 1.0f));
+    vec3 scale = Vec3(Check_RandomFloat(0.5f, 2.0f), Check_RandomFloat(0.5f, 2.0f), Check_RandomFloat(0.5f, 2.0f));
+    mat4 result = Mat4FromTRS(translation, Check_RandomFloat(-180.0f, 180.0f), axis, scale);
+    return result;
+}
+
+quat Check_RandomQuat(void)
+{
+    vec3 axis = Vec3(Check_RandomFloat(0.1f, 1.0f), Check_RandomFloat(-1.0f, 1.0f), Check_RandomFloat(-1.0f, 1.0f));
+    quat result = QuatFromAxisAngle(Check_RandomFloat(-180.0f, 180.0f), axis);
+    return result;
+}
+
+// Rodrigues' rotation formula, kept apart from the quaternion path that
+// Rotate and Mat3FromAxisAngle go through so it can be checked against.
+mat4 Check_AxisAngleMat4(float angle, vec3 axis)
+{
+    double radians = (double)angle * 3.14159265358979323846 / 180.0;
+    double length = sqrt((double)axis.x * (double)axis.x + (double)axis.y * (double)axis.y + (double)axis.z * (double)axis.z);
+    double x = (double)axis.x / length;
+    double y = (double)axis.y / length;
+    double z = (double)axis.z / length;
+    double c = cos(radians);
+    double s = sin(radians);
+    double t = 1.0 - c;
+
+    mat4 result = Mat4d(1.0f);
+    result.elements[0][0] = (float)(t * x * x + c);
+    result.elements[0][1] = (float)(t * x * y + s * z);
+    result.elements[0][2] = (float)(t * x * z - s * y);
+    result.elements[1][0] = (float)(t * x * y - s * z);
+    result.elements[1][1] = (float)(t * y * y + c);
+    result.elements[1][2] = (float)(t * y * z + s * x);
+    result.elements[2][0] = (float)(t * x * z + s * y);
+    result.elements[2][1] = (float)(t * y * z - s * x);
+    result.elements[2][2] = (float)(t * z * z + c);
+    return result;
+}
+
+double Check_MaxDifferenceMat4(mat4 a, mat4 b)
+{
+    double result = 0.0;
+    for(int col_idx = 0; col_idx < 4; ++col_idx)
+    {
+        for(int row_idx = 0; row_idx < 4; ++row_idx)
+        {
+            double difference = (double)a.elements[col_idx][row_idx] - (double)b.elements[col_idx][row_idx];
+            result = MAX(result, (difference < 0.0) ? -difference : difference);
+        }
+    }
+    return result;
+}
+
+double Check_MaxDifferenceVec4(vec4 a, vec4 b)
+{
+    double result = 0.0;
+    for(int component_idx = 0; component_idx < 4; ++component_idx)
+    {
+        double difference = (double)a.elements[component_idx] - (double)b.elements[component_idx];
+        result = MAX(result, (difference < 0.0) ? -difference : difference);
+    }
+    return result;
+}
+
+void Check_Record(CheckResult *result, double difference)
+{
+    result->max_difference = MAX(result->max_difference, difference);
+}
+
+int main(void)
+{
+    srand(1);
+
+    CheckResult checks[] =
+    {
+        { "MultiplyMat4",          0.0, CHECK_SIMD_TOLERANCE },
+        { "Transpose",             0.0, CHECK_SIMD_TOLERANCE },
+        { "AddMat4",               0.0, CHECK_SIMD_TOLERANCE },
+        { "SubtractMat4",          0.0, CHECK_SIMD_TOLERANCE },
+        { "MultiplyMat4f",         0.0, CHECK_SIMD_TOLERANCE },
+        { "MultiplyMat4ByVec4",    0.0, CHECK_SIMD_TOLERANCE },
+        { "InverseMat4",           0.0, CHECK_INVERSE_TOLERANCE },
+        { "ComposeModelMatrices",  0.0, CHECK_SIMD_TOLERANCE },
+        { "MultiplyAffine",        0.0, CHECK_SIMD_TOLERANCE },
+        { "InverseAffine",         0.0, CHECK_INVERSE_TOLERANCE },
+        { "MultiplyAffineBatch",   0.0, CHECK_SIMD_TOLERANCE },
+        { "QuatFromAxisAngle",     0.0, CHECK_ROTATION_TOLERANCE },
+        { "Rotate",                0.0, CHECK_ROTATION_TOLERANCE },
+        { "MultiplyQuat",          0.0, CHECK_ROTATION_TOLERANCE },
+        { "RotateVec3ByQuat",      0.0, CHECK_ROTATION_TOLERANCE },
+        { "NLerp",                 0.0, CHECK_ROTATION_TOLERANCE },
+        { "SLerp",                 0.0, CHECK_ROTATION_TOLERANCE },
+        { "Mat4FromTRS",           0.0, CHECK_ROTATION_TOLERANCE },
+        { "Mat4FromTRSQuat",       0.0, CHECK_ROTATION_TOLERANCE },
+        { "InverseLookAt",         0.0, CHECK_INVERSE_TOLERANCE },
+        { "InversePerspective",    0.0, CHECK_INVERSE_TOLERANCE },
+        { "MultiplyMat4Batch",     0.0, CHECK_SIMD_TOLERANCE },
+    };
+
+    mat4 identity = Mat4d(1.0f);
+    for(int input_idx = 0; input_idx < CHECK_INPUT_COUNT; ++input_idx)
+    {
+        mat4 a = Check_RandomMat4();
+        mat4 b = Check_RandomMat4();
+        vec4 v = Vec4(Check_RandomFloat(-2.0f, 2.0f), Check_RandomFloat(-2.0f, 2.0f),
+                      Check_RandomFloat(-2.0f, 2.0f), Check_RandomFloat(-2.0f, 2.0f));
+        float f = Check_RandomFloat(-2.0f, 2.0f);
+
+        Check_Record(checks + 0, Check_MaxDifferenceMat4(MultiplyMat4(a, b), MultiplyMat4Scalar(a, b)));
+        Check_Record(checks + 1, Check_MaxDifferenceMat4(Transpose(a), TransposeScalar(a)));
+        Check_Record(checks + 2, Check_MaxDifferenceMat4(AddMat4(a, b), AddMat4Scalar(a, b)));
+        Check_Record(checks + 3, Check_MaxDifferenceMat4(SubtractMat4(a, b), SubtractMat4Scalar(a, b)));
+        Check_Record(checks + 4, Check_MaxDifferenceMat4(MultiplyMat4f(a, f), MultiplyMat4fScalar(a, f)));
+        Check_Record(checks + 5, Check_MaxDifferenceVec4(MultiplyMat4ByVec4(a, v), MultiplyMat4ByVec4Scalar(a, v)));
+
+        // NOTE(sokus): InverseMat4 has a single implementation, it's checked
+        // through both multiply paths. The diagonal keeps A well conditioned.
+        mat4 invertible = AddMat4Scalar(a, Mat4d(5.0f));
+        mat4 inverse = InverseMat4(invertible);
+        Check_Record(checks + 6, Check_MaxDifferenceMat4(MultiplyMat4(invertible, inverse), identity));
+        Check_Record(checks + 6, Check_MaxDifferenceMat4(MultiplyMat4Scalar(invertible, inverse), identity));
+
+        // NOTE(sokus): The affine helpers are checked against the generic
+        // functions on matrices with a (0, 0, 0, 1) last row.
+        mat4 affine_a = Check_RandomAffine();
+        mat4 affine_b = Check_RandomAffine();
+        Check_Record(checks + 8, Check_MaxDifferenceMat4(MultiplyAffine(affine_a, affine_b), MultiplyMat4Scalar(affine_a, affine_b)));
+        Check_Record(checks + 9, Check_MaxDifferenceMat4(InverseAffine(affine_a), InverseMat4(affine_a)));
+
+        // NOTE(sokus): Axes aren't unit length, QuatFromAxisAngle and Rotate
+        // have to normalize them. Mat4FromQuat (and with it Mat3FromQuat)
+        // is what turns every quaternion here back into something to compare.
+        float angle = Check_RandomFloat(-180.0f, 180.0f);
+        vec3 axis = Vec3(Check_RandomFloat(-3.0f, 3.0f), Check_RandomFloat(-3.0f, 3.0f), Check_RandomFloat(0.1f, 3.0f));
+        mat4 rotation = Check_AxisAngleMat4(angle, axis);
+        Check_Record(checks + 11, Check_MaxDifferenceMat4(Mat4FromQuat(QuatFromAxisAngle(angle, axis)), rotation));
+        Check_Record(checks + 12, Check_MaxDifferenceMat4(RotateVec3(a, angle, axis), MultiplyMat4Scalar(rotation, a)));
+
+        quat quat_a = Check_RandomQuat();
+        quat quat_b = Check_RandomQuat();
+        mat4 rotation_a = Mat4FromQuat(quat_a);
+        Check_Record(checks + 13, Check_MaxDifferenceMat4(Mat4FromQuat(MultiplyQuat(quat_a, quat_b)),
+                                                          MultiplyMat4Scalar(rotation_a, Mat4FromQuat(quat_b))));
+        Check_Record(checks + 14, Check_MaxDifferenceVec4(Vec4v(RotateVec3ByQuat(quat_a, v.xyz), 0.0f),
+                                                          MultiplyMat4ByVec4Scalar(rotation_a, Vec4v(v.xyz, 0.0f))));
+
+        // NOTE(sokus): Between two rotations around the same axis both
+        // interpolations stay on that axis. SLerp moves the angle linearly,
+        // NLerp only hits the ends and the middle. The end quaternion is
+        // flipped half the time, the shorter arc has to be picked either way.
+        float from_angle = Check_RandomFloat(-80.0f, 80.0f);
+        float to_angle = Check_RandomFloat(-80.0f, 80.0f);
+        float t = Check_RandomFloat(0.0f, 1.0f);
+        quat from = QuatFromAxisAngle(from_angle, axis);
+        quat to = QuatFromAxisAngle(to_angle, axis);
+        if(input_idx & 1)
+            to = Quat(-to.x, -to.y, -to.z, -to.w);
+        Check_Record(checks + 15, Check_MaxDifferenceMat4(Mat4FromQuat(NLerp(from, 0.0f, to)), Check_AxisAngleMat4(from_angle, axis)));
+        Check_Record(checks + 15, Check_MaxDifferenceMat4(Mat4FromQuat(NLerp(from, 0.5f, to)), Check_AxisAngleMat4(0.5f * (from_angle + to_angle), axis)));
+        Check_Record(checks + 15, Check_MaxDifferenceMat4(Mat4FromQuat(NLerp(from, 1.0f, to)), Check_AxisAngleMat4(to_angle, axis)));
+        Check_Record(checks + 16, Check_MaxDifferenceMat4(Mat4FromQuat(SLerp(from, t, to)), Check_AxisAngleMat4(Lerp(from_angle, t, to_angle), axis)));
+
+        // NOTE(sokus): The TRS builders against the step by step version.
+        vec3 translation = Vec3(Check_RandomFloat(-10.0f, 10.0f), Check_RandomFloat(-10.0f, 10.0f), Check_RandomFloat(-10.0f, 10.0f));
+        vec3 scale = Vec3(Check_RandomFloat(0.5f, 2.0f), Check_RandomFloat(0.5f, 2.0f), Check_RandomFloat(0.5f, 2.0f));
+        mat4 trs = TranslateVec3(RotateVec3(ScaleVec3(identity, scale), angle, axis), translation);
+        Check_Record(checks + 17, Check_MaxDifferenceMat4(Mat4FromTRS(translation, angle, axis, scale), trs));
+        Check_Record(checks + 18, Check_MaxDifferenceMat4(Mat4FromTRSQuat(translation, QuatFromAxisAngle(angle, axis), scale), trs));
+
+        vec3 eye = Vec3(Check_RandomFloat(-10.0f, 10.0f), Check_RandomFloat(-10.0f, 10.0f), Check_RandomFloat(-10.0f, 10.0f));
+        vec3 center = AddVec3(eye, Vec3(Check_RandomFloat(-5.0f, 5.0f), Check_RandomFloat(-1.0f, 1.0f), Check_RandomFloat(1.0f, 5.0f)));
+        vec3 up = Vec3(0.0f, 1.0f, 0.0f);
+        Check_Record(checks + 19, Check_MaxDifferenceMat4(MultiplyMat4Scalar(InverseLookAt(eye, center, up), LookAt(eye, center, up)), identity));
+
+        float fov = Check_RandomFloat(30.0f, 100.0f);
+        float aspect_ratio = Check_RandomFloat(0.5f, 2.5f);
+        float near = Check_RandomFloat(0.05f, 1.0f);
+        float far = Check_RandomFloat(10.0f, 1000.0f);
+        Check_Record(checks + 20, Check_MaxDifferenceMat4(MultiplyMat4Scalar(InversePerspective(fov, aspect_ratio, near, far),
+                                                                             Perspective(fov, aspect_ratio, near, far)), identity));
+    }
+
+    // NOTE(sokus): 61 so the scalar tail after the SIMD loop gets checked too.
+    // The batch kernels write with a stride that isn't a multiple of 16,
+    // from an offset that isn't either, like into a packed vertex buffer.
+    static float transform_data[10][64];
+    static float simd_data[64 * 17 + 1];
+    static float batch_data[64 * 17 + 1];
+    static mat4 scalar_matrices[64];
+    float *simd_matrices = simd_data + 1;
+    float *batch_matrices = batch_data + 1;
+    size_t stride = 17 * sizeof(float);
+    for(int array_idx = 0; array_idx < 10; ++array_idx)
+        for(int value_idx = 0; value_idx < 64; ++value_idx)
+            transform_data[array_idx][value_idx] = Check_RandomFloat(-2.0f, 2.0f);
+    TransformArrays transforms = {
+        transform_data[0], transform_data[1], transform_data[2],
+        transform_data[3], transform_data[4], transform_data[5], transform_data[6],
+        transform_data[7], transform_data[8], transform_data[9],
+    };
+    ComposeModelMatrices(&transforms, 0, 61, simd_matrices, stride);
+    ComposeModelMatricesScalar(&transforms, 0, 61, scalar_matrices, sizeof(mat4));
+    for(int matrix_idx = 0; matrix_idx < 61; ++matrix_idx)
+        Check_Record(checks + 7, Check_MaxDifferenceMat4(LoadStridedMat4(simd_matrices, stride, matrix_idx), scalar_matrices[matrix_idx]));
+
+    mat4 view = LookAt(Vec3(0.0f, 2.0f, 5.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f));
+    mat4 view_projection = MultiplyMat4Scalar(Perspective(40.0f, 16.0f / 9.0f, 0.1f, 100.0f), view);
+    MultiplyMat4Batch(&view_projection, simd_matrices, stride, batch_matrices, stride, 61);
+    for(int matrix_idx = 0; matrix_idx < 61; ++matrix_idx)
+        Check_Record(checks + 21, Check_MaxDifferenceMat4(LoadStridedMat4(batch_matrices, stride, matrix_idx),
+                                                          MultiplyMat4Scalar(view_projection, scalar_matrices[matrix_idx])));
+
+    MultiplyAffineBatch(&view, simd_matrices, stride, simd_matrices, stride, 61);
+    for(int matrix_idx = 0; matrix_idx < 61; ++matrix_idx)
+        Check_Record(checks + 10, Check_MaxDifferenceMat4(LoadStridedMat4(simd_matrices, stride, matrix_idx),
+                                                          MultiplyMat4Scalar(view, scalar_matrices[matrix_idx])));
+
+    bool result = true;
+    printf("wm_math.h checks (sse %d, avx %d):\n", WM_MATH_SSE, WM_MATH_AVX);
+    for(int check_idx = 0; check_idx < (int)ARRAY_SIZE(checks); ++check_idx)
+    {
+        CheckResult *check = checks + check_idx;
+        bool passed = (check->max_difference <= check->tolerance);
+        printf("%-24s max difference %-12g %s\n", check->name, check->max_difference, passed ? "ok" : "FAILED");
+        result = result && passed;
+    }
+
+    return result ? 0 : 1;
+}
@@ -52,4 +52,22 @@ typedef struct Input
     float keys_down_duration_previous[InputKey_Count];
 } Input;
 
+typedef enum SwapMode
+{
+    SwapMode_Immediate,
+    SwapMode_VSync,
+    SwapMode_AdaptiveVSync, // vsync, but late frames tear instead of waiting another refresh
+} SwapMode;
+
+char *SwapModeName(SwapMode swap_mode)
+{
+    switch(swap_mode)
+    {
+        case SwapMode_Immediate:     return "immediate";
+        case SwapMode_VSync:         return "vsync";
+        case SwapMode_AdaptiveVSync: return "adaptive vsync";
+        default:                     return "invalid";
+    }
+}
+
 #endif //WM_PLATFORM_H
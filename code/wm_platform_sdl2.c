@@ -5,6 +5,31 @@ float SDL2_GetSecondsElapsed(unsigned long int start_counter, unsigned long int
     return result;
 }
 
+// NOTE(sokus): Not every driver does adaptive vsync, or vsync at all. Falls
+// back one mode at a time and returns the one that stuck.
+SwapMode SDL2_SetSwapMode(SwapMode swap_mode)
+{
+    SwapMode result = swap_mode;
+    if(result == SwapMode_AdaptiveVSync && SDL_GL_SetSwapInterval(-1) != 0)
+        result = SwapMode_VSync;
+    if(result == SwapMode_VSync && SDL_GL_SetSwapInterval(1) != 0)
+        result = SwapMode_Immediate;
+    if(result == SwapMode_Immediate)
+        SDL_GL_SetSwapInterval(0);
+    return result;
+}
+
+// NOTE(sokus): Refresh rate of the display the window is on, 0 if unknown.
+int SDL2_GetRefreshRate(SDL_Window *window)
+{
+    int result = 0;
+    SDL_DisplayMode display_mode;
+    int display_idx = SDL_GetWindowDisplayIndex(window);
+    if(display_idx >= 0 && SDL_GetCurrentDisplayMode(display_idx, &display_mode) == 0)
+        result = display_mode.refresh_rate;
+    return result;
+}
+
 void SDL2_ProcessEvent(SDL_Event *event, SDL_Window *window,
                        Input *input, bool *is_running, bool *fullscreen, bool *mouse_relative)
 {
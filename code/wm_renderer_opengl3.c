@@ -1,10 +1,48 @@
-GLuint CreateProgram(char *vertex_shader_source, char *fragment_shader_source, char *debug_name)
+// NOTE(sokus): Everything the shaders read per frame (camera, light, time)
+// comes from uniform blocks and everything per draw from instance
+// attributes, so programs have no plain uniforms to look up.
+typedef struct Program
 {
+    GLuint handle;
+} Program;
+
+// NOTE(sokus): A block's ID is also its binding point. Names are looked up
+// once when a program links, blocks a program doesn't use are skipped.
+typedef enum UniformBlockID
+{
+    UniformBlock_FrameConstants,
+    
+    UniformBlock_Count,
+} UniformBlockID;
+
+global char *uniform_block_names[UniformBlock_Count] =
+{
+    [UniformBlock_FrameConstants] = "FrameConstants",
+};
+
+void BindUniformBlocks(Program *program)
+{
+    for(int block_idx = 0; block_idx < UniformBlock_Count; ++block_idx)
+    {
+        GLuint block_index = glGetUniformBlockIndex(program->handle, uniform_block_names[block_idx]);
+        if(block_index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program->handle, block_index, (GLuint)block_idx);
+    }
+}
+
+// NOTE(sokus): Sources don't have to be zero terminated, which lets us pass
+// mapped files straight through.
+Program CreateProgram(char *vertex_shader_source, size_t vertex_shader_length,
+                      char *fragment_shader_source, size_t fragment_shader_length,
+                      char *debug_name)
+{
+    Program result = {0};
     int success;
     char info_log[512];
     
     GLuint vertex_shader_handle = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader_handle, 1, (const char * const *)&vertex_shader_source, 0);
+    GLint vertex_shader_gl_length = (GLint)vertex_shader_length;
+    glShaderSource(vertex_shader_handle, 1, (const char * const *)&vertex_shader_source, &vertex_shader_gl_length);
     glCompileShader(vertex_shader_handle);
     glGetShaderiv(vertex_shader_handle, GL_COMPILE_STATUS, &success);
     if(!success)
@@ -15,7 +53,8 @@ GLuint CreateProgram(char *vertex_shader_source, char *fragment_shader_source, c
     }
     
     GLuint fragment_shader_handle = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader_handle, 1, (const char * const *)&fragment_shader_source, 0);
+    GLint fragment_shader_gl_length = (GLint)fragment_shader_length;
+    glShaderSource(fragment_shader_handle, 1, (const char * const *)&fragment_shader_source, &fragment_shader_gl_length);
     glCompileShader(fragment_shader_handle);
     glGetShaderiv(fragment_shader_handle, GL_COMPILE_STATUS, &success);
     if(!success)
@@ -42,36 +81,906 @@ GLuint CreateProgram(char *vertex_shader_source, char *fragment_shader_source, c
     glDetachShader(program_handle, fragment_shader_handle);
     glDeleteShader(fragment_shader_handle);
     
-    return program_handle;
+    result.handle = program_handle;
+    BindUniformBlocks(&result);
+    
+    return result;
+}
+
+//~NOTE(sokus): per-frame constants
+
+// NOTE(sokus): Laid out according to std140, keep in sync with the shaders.
+typedef struct FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+    vec4 light_pos;
+    vec4 view_light_pos;
+    vec4 light_color;
+    float time;
+    float padding[3];
+} FrameConstants;
+
+GLuint CreateFrameConstantsBuffer(void)
+{
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), 0, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UniformBlock_FrameConstants, buffer);
+    return buffer;
+}
+
+void UpdateFrameConstants(GLuint buffer, FrameConstants *constants)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), constants);
+}
+
+
+//~NOTE(sokus): instance buffer
+
+// Vertex attribute locations used by the per-instance data, they have to
+// match the layout declared in the shaders (a matN takes N slots).
+#define INSTANCE_ATTRIB_MODEL_VIEW_PROJECTION 2
+#define INSTANCE_ATTRIB_MODEL_VIEW 6
+#define INSTANCE_ATTRIB_NORMAL_MATRIX 10
+#define INSTANCE_ATTRIB_COLOR 13
+
+// NOTE(sokus): All the matrices are computed on the CPU so the vertex
+// shader doesn't have to multiply or invert anything per vertex.
+// Normal matrix columns are padded to vec4.
+typedef struct InstanceData
+{
+    mat4 model_view_projection;
+    mat4 model_view;
+    vec4 normal_matrix[3];
+    vec4 color;
+} InstanceData;
+
+// NOTE(sokus): One instance buffer for the whole frame. It gets orphaned and
+// mapped before recording and commands write their instances straight into
+// it, from whichever thread records them, only the GL calls have to stay on
+// the main thread. Executing unmaps it and draws every run of instances with
+// a base instance, nothing gets copied after recording.
+//
+// Threads take INSTANCE_CHUNK_SIZE instances at a time so the commands one
+// thread pushes in a row end up next to each other and can go out as a
+// single draw.
+#define INSTANCE_CHUNK_SIZE 256
+
+typedef struct InstanceBuffer
+{
+    GLuint vbo;
+    InstanceData *instances; // mapped, 0 outside MapInstanceBuffer/UnmapInstanceBuffer
+    atomic_int allocated;
+    int capacity;
+} InstanceBuffer;
+
+void InitializeInstanceBuffer(InstanceBuffer *buffer, int capacity)
+{
+    ASSERT(capacity > 0);
+    MEMORY_SET(buffer, 0, sizeof(InstanceBuffer));
+    atomic_init(&buffer->allocated, 0);
+    buffer->capacity = capacity;
+    
+    glGenBuffers(1, &buffer->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer->vbo);
+    glBufferData(GL_ARRAY_BUFFER, capacity * (GLsizeiptr)sizeof(InstanceData), 0, GL_STREAM_DRAW);
+}
+
+void DestroyInstanceBuffer(InstanceBuffer *buffer)
+{
+    glDeleteBuffers(1, &buffer->vbo);
+    buffer->vbo = 0;
+}
+
+// Binds the instance buffer to the per-instance attributes of a VAO. Has to
+// be called once for every VAO that is going to be drawn with it.
+void AttachInstanceBufferToVertexArray(InstanceBuffer *buffer, GLuint vao)
+{
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer->vbo);
+    
+    GLsizei stride = (GLsizei)sizeof(InstanceData);
+    for(GLuint column_idx = 0; column_idx < 4; ++column_idx)
+    {
+        GLuint location = INSTANCE_ATTRIB_MODEL_VIEW_PROJECTION + column_idx;
+        size_t offset = offsetof(InstanceData, model_view_projection) + column_idx * sizeof(vec4);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void *)offset);
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    
+    for(GLuint column_idx = 0; column_idx < 4; ++column_idx)
+    {
+        GLuint location = INSTANCE_ATTRIB_MODEL_VIEW + column_idx;
+        size_t offset = offsetof(InstanceData, model_view) + column_idx * sizeof(vec4);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void *)offset);
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    
+    for(GLuint column_idx = 0; column_idx < 3; ++column_idx)
+    {
+        GLuint location = INSTANCE_ATTRIB_NORMAL_MATRIX + column_idx;
+        size_t offset = offsetof(InstanceData, normal_matrix) + column_idx * sizeof(vec4);
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride, (void *)offset);
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    
+    glVertexAttribPointer(INSTANCE_ATTRIB_COLOR, 4, GL_FLOAT, GL_FALSE, stride,
+                          (void *)offsetof(InstanceData, color));
+    glEnableVertexAttribArray(INSTANCE_ATTRIB_COLOR);
+    glVertexAttribDivisor(INSTANCE_ATTRIB_COLOR, 1);
+    
+    glBindVertexArray(0);
+}
+
+// NOTE(sokus): Invalidating the whole range orphans last frame's storage,
+// the draws still reading from it don't make us wait.
+bool MapInstanceBuffer(InstanceBuffer *buffer)
+{
+    ASSERT(!buffer->instances);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer->vbo);
+    buffer->instances = (InstanceData *)glMapBufferRange(GL_ARRAY_BUFFER, 0,
+                                                         buffer->capacity * (GLsizeiptr)sizeof(InstanceData),
+                                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    atomic_store_explicit(&buffer->allocated, 0, memory_order_relaxed);
+    
+    bool result = (buffer->instances != 0);
+    if(!result)
+        fprintf(stderr, "ERROR: Failed to map the instance buffer!\n");
+    return result;
+}
+
+// NOTE(sokus): False when there was nothing mapped or the driver lost the
+// contents (it's allowed to, on a mode switch for one), the frame's
+// instances can't be drawn then.
+bool UnmapInstanceBuffer(InstanceBuffer *buffer)
+{
+    bool result = false;
+    if(buffer->instances)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer->vbo);
+        result = (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE);
+        buffer->instances = 0;
+    }
+    return result;
+}
+
+// NOTE(sokus): Draws instances that sit next to each other in the instance
+// buffer with whatever program and VAO are bound right now, returns whether
+// there was anything to draw.
+bool DrawInstanceRange(int vertex_count, int first_instance, int instance_count)
+{
+    bool result = (instance_count > 0);
+    if(result)
+    {
+        glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, vertex_count, instance_count,
+                                          (GLuint)first_instance);
+    }
+    return result;
+}
+
+void WriteInstance(InstanceData *instance, mat4 *view, mat4 *view_projection, mat4 *model, vec4 color)
+{
+    mat4 model_view = ModelView(*view, *model);
+    mat3 normal_matrix = InverseTransposeMat3(model_view);
+    
+    instance->model_view_projection = ModelViewProjection(*view_projection, *model);
+    instance->model_view = model_view;
+    instance->normal_matrix[0] = Vec4v(normal_matrix.columns[0], 0.0f);
+    instance->normal_matrix[1] = Vec4v(normal_matrix.columns[1], 0.0f);
+    instance->normal_matrix[2] = Vec4v(normal_matrix.columns[2], 0.0f);
+    instance->color = color;
+}
+
+// Fills instances straight from structure-of-arrays transforms. The
+// instances are usually mapped GL memory, which can be very slow to read
+// back, so the matrices get composed in a small block on the stack and the
+// instances are only ever written.
+#define WRITE_INSTANCES_BLOCK_SIZE 16
+
+void WriteInstances(InstanceData *instances, mat4 *view, mat4 *view_projection,
+                    TransformArrays *transforms, int first, int count, vec4 color)
+{
+    size_t stride = sizeof(InstanceData);
+    mat4 models[WRITE_INSTANCES_BLOCK_SIZE];
+    mat4 model_views[WRITE_INSTANCES_BLOCK_SIZE];
+    
+    for(int block_first = 0; block_first < count; block_first += WRITE_INSTANCES_BLOCK_SIZE)
+    {
+        int block_count = MIN(WRITE_INSTANCES_BLOCK_SIZE, count - block_first);
+        InstanceData *block = instances + block_first;
+        ComposeModelMatrices(transforms, first + block_first, block_count, models, sizeof(mat4));
+        MultiplyMat4Batch(view_projection, models, sizeof(mat4),
+                          &block->model_view_projection, stride, block_count);
+        MultiplyAffineBatch(view, models, sizeof(mat4), model_views, sizeof(mat4), block_count);
+        
+        for(int instance_idx = 0; instance_idx < block_count; ++instance_idx)
+        {
+            InstanceData *instance = block + instance_idx;
+            mat3 normal_matrix = InverseTransposeMat3(model_views[instance_idx]);
+            instance->model_view = model_views[instance_idx];
+            instance->normal_matrix[0] = Vec4v(normal_matrix.columns[0], 0.0f);
+            instance->normal_matrix[1] = Vec4v(normal_matrix.columns[1], 0.0f);
+            instance->normal_matrix[2] = Vec4v(normal_matrix.columns[2], 0.0f);
+            instance->color = color;
+        }
+    }
+}
+
+//~NOTE(sokus): textures
+
+typedef enum TextureID
+{
+    TextureID_Sprites,
+    TextureID_Glyphs,
+    
+    TextureID_Count,
+} TextureID;
+
+// NOTE(sokus): Atlases are uploaded as array textures, one layer per tile.
+// internal_format is GL_RGB8, GL_RGBA8 or a compressed format baked by the
+// packer (only BC7 for now, the one compressed format core in 4.2).
+typedef struct OpenGL3_Texture
+{
+    bool is_loaded;
+    int pending_uploads; // streamed levels not submitted yet
+    GLuint id;
+    GLenum internal_format;
+    int mip_count;
+    int width;
+    int height;
+    int channels;
+    int tile_width;
+    int tile_height;
+    int tile_count_x;
+    int tile_count_y;
+    int tile_count;
+} OpenGL3_Texture;
+
+GLenum OpenGL3_TextureFormat(int channels)
+{
+    GLenum result = (channels == 3 ? GL_RGB8 :
+                     channels == 4 ? GL_RGBA8 : 0);
+    if(result == 0)
+        fprintf(stderr, "ERROR: Channel count (%d) not supported!\n", channels);
+    return result;
+}
+
+bool OpenGL3_IsCompressedFormat(GLenum internal_format)
+{
+    bool result = (internal_format == GL_COMPRESSED_RGBA_BPTC_UNORM);
+    return result;
+}
+
+// NOTE(sokus): Bytes in one layer of a mip level, compressed levels are
+// rounded up to whole 4x4 blocks.
+size_t OpenGL3_TextureLayerSize(GLenum internal_format, int width, int height, int level)
+{
+    size_t level_width = (size_t)MAX(width >> level, 1);
+    size_t level_height = (size_t)MAX(height >> level, 1);
+    size_t result = (internal_format == GL_COMPRESSED_RGBA_BPTC_UNORM ?
+                     ((level_width + 3) / 4) * ((level_height + 3) / 4) * 16 :
+                     level_width * level_height * (internal_format == GL_RGB8 ? 3 : 4));
+    return result;
+}
+
+// NOTE(sokus): Allocates immutable storage for the array texture and every
+// mip level, and leaves it bound. The caller fills in the layers.
+GLuint OpenGL3_CreateArrayTexture(GLenum internal_format, int tile_width, int tile_height,
+                                  int tile_count, int mip_count)
+{
+    GLuint result;
+    glGenTextures(1, &result);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, result);
+    
+    float texture_border_color[] = { 1.0f, 0.0f, 1.0f, 1.0f };
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                    mip_count > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, mip_count - 1);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, texture_border_color);
+    
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, mip_count, internal_format, tile_width, tile_height, tile_count);
+    return result;
+}
+
+void OpenGL3_DestroyTextures(OpenGL3_Texture *textures, int texture_count)
+{
+    for(int texture_idx = 0; texture_idx < texture_count; ++texture_idx)
+    {
+        OpenGL3_Texture *texture = textures + texture_idx;
+        if(texture->id)
+            glDeleteTextures(1, &texture->id);
+        MEMORY_SET(texture, 0, sizeof(*texture));
+    }
+}
+
+//~NOTE(sokus): texture streaming
+
+// NOTE(sokus): Layers go up through a ring of pixel buffers instead of
+// straight from client memory, so glTexSubImage3D returns right away and
+// the copy into the texture happens on the GPU's own time. Each buffer is
+// orphaned before it's mapped and fenced after its upload. If the fence of
+// the next buffer hasn't passed yet we stop for this frame instead of
+// waiting on it. No persistent mapping since glBufferStorage is 4.4.
+//
+// Every frame uploads at most upload_budget bytes (but always at least one
+// layer), big loads get spread over several frames instead of causing a hitch.
+// Compressed levels go through the same buffers untouched, the block data
+// is copied as is.
+
+#define TEXTURE_STREAM_BUFFER_COUNT 3
+#define TEXTURE_STREAM_QUEUE_CAPACITY 64
+
+typedef struct TextureUpload
+{
+    OpenGL3_Texture *texture; // marked loaded once its last upload is submitted
+    GLuint texture_id;
+    GLenum format; // pixel format, or the internal format when compressed
+    bool compressed;
+    int level;
+    int width;
+    int height;
+    int first_layer;
+    int layer_count;
+    int layers_done;
+    size_t layer_size;
+    uint8_t *source; // has to stay valid until the upload finishes
+    uint32_t tag;    // handed back by UpdateTextureStreamer when the texture is done
+} TextureUpload;
+
+typedef struct TextureStreamer
+{
+    GLuint buffers[TEXTURE_STREAM_BUFFER_COUNT];
+    GLsync fences[TEXTURE_STREAM_BUFFER_COUNT];
+    int next_buffer;
+    size_t buffer_size;
+    size_t upload_budget;
+    
+    TextureUpload *uploads;
+    int first_upload;
+    int upload_count;
+    
+    // NOTE(sokus): stats
+    uint64_t bytes_uploaded;
+    uint64_t layers_uploaded;
+    uint64_t frames_blocked; // frames cut short by a fence still pending
+} TextureStreamer;
+
+void InitializeTextureStreamer(TextureStreamer *streamer, MemoryArena *arena,
+                               size_t buffer_size, size_t upload_budget)
+{
+    MEMORY_SET(streamer, 0, sizeof(*streamer));
+    glGenBuffers(TEXTURE_STREAM_BUFFER_COUNT, streamer->buffers);
+    streamer->buffer_size = buffer_size;
+    streamer->upload_budget = upload_budget;
+    streamer->uploads = PUSH_ARRAY(arena, TextureUpload, TEXTURE_STREAM_QUEUE_CAPACITY);
+}
+
+void DestroyTextureStreamer(TextureStreamer *streamer)
+{
+    for(int buffer_idx = 0; buffer_idx < TEXTURE_STREAM_BUFFER_COUNT; ++buffer_idx)
+    {
+        if(streamer->fences[buffer_idx])
+            glDeleteSync(streamer->fences[buffer_idx]);
+    }
+    glDeleteBuffers(TEXTURE_STREAM_BUFFER_COUNT, streamer->buffers);
+    MEMORY_SET(streamer->buffers, 0, sizeof(streamer->buffers));
+}
+
+// NOTE(sokus): Layers of one mip level of an existing array texture, also
+// how dynamic textures get refreshed. The source holds the layers one after
+// another, OpenGL3_TextureLayerSize bytes each.
+bool QueueTextureUpload(TextureStreamer *streamer, OpenGL3_Texture *texture, int level,
+                        int first_layer, int layer_count, uint8_t *source, uint32_t tag)
+{
+    bool result = (streamer->upload_count < TEXTURE_STREAM_QUEUE_CAPACITY);
+    if(result)
+    {
+        int upload_idx = (streamer->first_upload + streamer->upload_count) % TEXTURE_STREAM_QUEUE_CAPACITY;
+        TextureUpload *upload = streamer->uploads + upload_idx;
+        upload->texture = texture;
+        upload->texture_id = texture->id;
+        upload->compressed = OpenGL3_IsCompressedFormat(texture->internal_format);
+        upload->format = (upload->compressed ? texture->internal_format :
+                          texture->internal_format == GL_RGB8 ? GL_RGB : GL_RGBA);
+        upload->level = level;
+        upload->width = MAX(texture->tile_width >> level, 1);
+        upload->height = MAX(texture->tile_height >> level, 1);
+        upload->first_layer = first_layer;
+        upload->layer_count = layer_count;
+        upload->layers_done = 0;
+        upload->layer_size = OpenGL3_TextureLayerSize(texture->internal_format, texture->tile_width,
+                                                      texture->tile_height, level);
+        upload->source = source;
+        upload->tag = tag;
+        ++streamer->upload_count;
+        ++texture->pending_uploads;
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Texture upload queue full!\n");
+    }
+    return result;
+}
+
+// NOTE(sokus): Allocates the texture now and streams the tiles in over the
+// next frames, is_loaded gets set once all of them are submitted. The tiles
+// are stored level by level, every level holding all the layers (the way
+// the packer bakes them), so each level is one upload.
+bool OpenGL3_CreateStreamedTexture(OpenGL3_Texture *texture, TextureStreamer *streamer,
+                                   uint8_t *tiles, int tile_width, int tile_height,
+                                   int tile_count_x, int tile_count_y, int channels,
+                                   GLenum internal_format, int mip_count, uint32_t tag)
+{
+    if(texture->id)
+    {
+        fprintf(stderr, "ERROR: OpenGL3_Texture already loaded!\n");
+        return false;
+    }
+    if(internal_format == 0)
+        return false;
+    if(streamer->upload_count + mip_count > TEXTURE_STREAM_QUEUE_CAPACITY)
+    {
+        fprintf(stderr, "ERROR: Texture upload queue full!\n");
+        return false;
+    }
+    
+    int tile_count = tile_count_x * tile_count_y;
+    ASSERT(tile_width > 0 && tile_height > 0 && tile_count > 0 && mip_count > 0);
+    
+    texture->is_loaded = false;
+    texture->pending_uploads = 0;
+    texture->id = OpenGL3_CreateArrayTexture(internal_format, tile_width, tile_height, tile_count, mip_count);
+    texture->internal_format = internal_format;
+    texture->mip_count = mip_count;
+    texture->width = tile_width * tile_count_x;
+    texture->height = tile_height * tile_count_y;
+    texture->channels = channels;
+    texture->tile_width = tile_width;
+    texture->tile_height = tile_height;
+    texture->tile_count_x = tile_count_x;
+    texture->tile_count_y = tile_count_y;
+    texture->tile_count = tile_count;
+    
+    uint8_t *level_tiles = tiles;
+    for(int level = 0; level < mip_count; ++level)
+    {
+        QueueTextureUpload(streamer, texture, level, 0, tile_count, level_tiles, tag);
+        level_tiles += (size_t)tile_count * OpenGL3_TextureLayerSize(internal_format, tile_width, tile_height, level);
+    }
+    return true;
+}
+
+// NOTE(sokus): Call once a frame. Writes the tags of textures whose uploads
+// all finished reading their source into finished_tags and returns how many
+// there were.
+int UpdateTextureStreamer(TextureStreamer *streamer, uint32_t *finished_tags, int max_finished_tags)
+{
+    int finished_count = 0;
+    size_t budget_left = streamer->upload_budget;
+    bool first_layer_this_frame = true;
+    
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    while(streamer->upload_count > 0 && finished_count < max_finished_tags)
+    {
+        TextureUpload *upload = streamer->uploads + streamer->first_upload;
+        int layers_left = upload->layer_count - upload->layers_done;
+        
+        size_t chunk_limit = MAX(MIN(budget_left, streamer->buffer_size), upload->layer_size);
+        int chunk_layers = MIN(layers_left, (int)(chunk_limit / upload->layer_size));
+        if(!first_layer_this_frame && (size_t)chunk_layers * upload->layer_size > budget_left)
+            chunk_layers = (int)(budget_left / upload->layer_size);
+        if(chunk_layers <= 0)
+            break;
+        
+        int buffer_idx = streamer->next_buffer;
+        GLsync fence = streamer->fences[buffer_idx];
+        if(fence)
+        {
+            GLenum wait_result = glClientWaitSync(fence, 0, 0);
+            if(wait_result == GL_TIMEOUT_EXPIRED)
+            {
+                ++streamer->frames_blocked;
+                break;
+            }
+            if(wait_result == GL_WAIT_FAILED)
+            {
+                // NOTE(sokus): We can't tell whether the GPU is done with the
+                // buffer, wait for everything before writing over it.
+                fprintf(stderr, "ERROR: Waiting on a texture upload fence failed (0x%x), stalling.\n", glGetError());
+                glFinish();
+            }
+            glDeleteSync(fence);
+            streamer->fences[buffer_idx] = 0;
+        }
+        
+        size_t chunk_size = (size_t)chunk_layers * upload->layer_size;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, streamer->buffers[buffer_idx]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)MAX(chunk_size, streamer->buffer_size), 0, GL_STREAM_DRAW);
+        void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)chunk_size,
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if(mapped)
+        {
+            MEMORY_COPY(mapped, upload->source + (size_t)upload->layers_done * upload->layer_size, chunk_size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            
+            glBindTexture(GL_TEXTURE_2D_ARRAY, upload->texture_id);
+            int layer = upload->first_layer + upload->layers_done;
+            if(upload->compressed)
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, upload->level, 0, 0, layer,
+                                          upload->width, upload->height, chunk_layers, upload->format,
+                                          (GLsizei)chunk_size, 0);
+            else
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, upload->level, 0, 0, layer,
+                                upload->width, upload->height, chunk_layers, upload->format,
+                                GL_UNSIGNED_BYTE, 0);
+            streamer->fences[buffer_idx] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            streamer->next_buffer = (buffer_idx + 1) % TEXTURE_STREAM_BUFFER_COUNT;
+            
+            upload->layers_done += chunk_layers;
+            streamer->bytes_uploaded += chunk_size;
+            streamer->layers_uploaded += (uint64_t)chunk_layers;
+            budget_left -= MIN(budget_left, chunk_size);
+            first_layer_this_frame = false;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if(!mapped)
+            break;
+        
+        if(upload->layers_done == upload->layer_count)
+        {
+            if(--upload->texture->pending_uploads == 0)
+            {
+                upload->texture->is_loaded = true;
+                finished_tags[finished_count++] = upload->tag;
+            }
+            streamer->first_upload = (streamer->first_upload + 1) % TEXTURE_STREAM_QUEUE_CAPACITY;
+            --streamer->upload_count;
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    return finished_count;
+}
+
+//~NOTE(sokus): render commands
+
+// NOTE(sokus): Draws get recorded into a command buffer in the frame's
+// scratch arena instead of going to GL right away, their instances go
+// straight into the mapped instance buffer. Every command carries a 64-bit
+// sort key, ExecuteRenderCommands radix sorts the keys and then walks the
+// commands keeping track of what's bound, so a program or VAO only gets
+// bound when it actually changes. Neighbouring commands with the same state
+// and mesh whose instances sit next to each other go out as one draw.
+//
+// A command buffer is only ever pushed to by one thread. Recording can be
+// spread over threads by giving each its own buffer, executing takes all
+// of them and merges their keys before sorting.
+//
+// Key layout, from the most significant bit:
+//   pass 4 | program 8 | vao 8 | depth 24 | unused 20
+// Nothing draws textured yet, a texture field goes in after the program
+// once something does. The GL handles are truncated to 8 bits. Two of them
+// landing on the same value only costs an extra bind, executing compares
+// the real handles.
+
+#define RENDER_KEY_PASS_SHIFT 60
+#define RENDER_KEY_PROGRAM_SHIFT 52
+#define RENDER_KEY_VAO_SHIFT 44
+#define RENDER_KEY_DEPTH_SHIFT 20
+#define RENDER_KEY_DEPTH_MAX 0xFFFFFF
+
+#define RENDER_STATE_UNKNOWN 0xFFFFFFFFu
+
+typedef enum RenderPass
+{
+    RenderPass_Opaque,
+    RenderPass_Translucent, // pass 1 - depth to draw back to front
+    
+    RenderPass_Count,
+} RenderPass;
+
+typedef struct RenderCommand
+{
+    GLuint program;
+    GLuint vao;
+    int vertex_count;
+    int first_instance;
+    int instance_count;
+} RenderCommand;
+
+typedef struct RenderSortEntry
+{
+    uint64_t key;
+    uint32_t command_idx;
+    uint32_t list_idx; // filled in when the lists get merged
+} RenderSortEntry;
+
+typedef struct RenderCommands
+{
+    RenderCommand *commands;
+    RenderSortEntry *sort_entries;
+    int command_count;
+    int command_capacity;
     
+    // NOTE(sokus): The chunk of the instance buffer this list is filling,
+    // as instance indices.
+    InstanceBuffer *instance_buffer;
+    int chunk_next;
+    int chunk_end;
+    
+    mat4 view;
+    mat4 view_projection;
+} RenderCommands;
+
+// NOTE(sokus): Always counted, set WM_RENDER_STATS to 1 to have main dump
+// them on exit.
+#ifndef WM_RENDER_STATS
+#define WM_RENDER_STATS 0
+#endif
+
+typedef struct RenderStats
+{
+    uint64_t frames;
+    uint64_t commands;
+    uint64_t draw_calls;
+    uint64_t program_binds;
+    uint64_t vao_binds;
+} RenderStats;
+
+// NOTE(sokus): depth is 0 at the near plane and 1 at the far plane, clamped.
+uint64_t MakeRenderKey(RenderPass pass, GLuint program, GLuint vao, float depth)
+{
+    uint64_t quantized_depth = (uint64_t)(CLAMP(0.0f, depth, 1.0f) * (float)RENDER_KEY_DEPTH_MAX);
+    uint64_t result = (((uint64_t)pass << RENDER_KEY_PASS_SHIFT) |
+                       ((uint64_t)(program & 0xFF) << RENDER_KEY_PROGRAM_SHIFT) |
+                       ((uint64_t)(vao & 0xFF) << RENDER_KEY_VAO_SHIFT) |
+                       (quantized_depth << RENDER_KEY_DEPTH_SHIFT));
+    return result;
 }
 
-void SetBoolUniform(GLuint program, char *name, bool value)
+// NOTE(sokus): View space distance of a point remapped for MakeRenderKey.
+float RenderDepth(mat4 *view, vec3 position, float near_plane, float far_plane)
 {
-    GLint uniform_location = glGetUniformLocation(program, name);
-    glUniform1i(uniform_location, (int)value);
+    vec4 view_position = MultiplyMat4ByVec4(*view, Vec4v(position, 1.0f));
+    float result = (-view_position.z - near_plane) / (far_plane - near_plane);
+    return result;
 }
 
-void SetIntUniform(GLuint program, char *name, int value)
+// NOTE(sokus): The instance buffer has to be mapped while commands are
+// pushed, see MapInstanceBuffer.
+void BeginRenderCommands(RenderCommands *commands, MemoryArena *arena, int command_capacity,
+                         InstanceBuffer *instance_buffer, FrameConstants *frame_constants)
 {
-    GLint uniform_location = glGetUniformLocation(program, name);
-    glUniform1i(uniform_location, value);
+    MEMORY_SET(commands, 0, sizeof(*commands));
+    commands->commands = PUSH_ARRAY(arena, RenderCommand, (size_t)command_capacity);
+    commands->sort_entries = PUSH_ARRAY(arena, RenderSortEntry, (size_t)command_capacity);
+    commands->command_capacity = command_capacity;
+    commands->instance_buffer = instance_buffer;
+    commands->view = frame_constants->view;
+    commands->view_projection = frame_constants->view_projection;
 }
 
-void SetFloatUniform(GLuint program, char *name, float value)
+// NOTE(sokus): Takes instance_count instances from the list's chunk of the
+// instance buffer, starting a new chunk when they don't fit. Returns the
+// first one's index, or -1 when the instance buffer is full (or unmapped).
+int AllocateInstances(RenderCommands *commands, int instance_count)
 {
-    GLint uniform_location = glGetUniformLocation(program, name);
-    glUniform1f(uniform_location, value);
+    int result = -1;
+    InstanceBuffer *buffer = commands->instance_buffer;
+    if(instance_count > commands->chunk_end - commands->chunk_next && buffer->instances)
+    {
+        // NOTE(sokus): When nobody took any instances since our chunk, it
+        // just grows, the list's instances stay in one run.
+        int chunk_size = MAX(instance_count, INSTANCE_CHUNK_SIZE);
+        int chunk_end = commands->chunk_end;
+        if(chunk_end <= buffer->capacity - chunk_size &&
+           atomic_compare_exchange_strong_explicit(&buffer->allocated, &chunk_end, chunk_end + chunk_size,
+                                                   memory_order_relaxed, memory_order_relaxed))
+        {
+            commands->chunk_end += chunk_size;
+        }
+        else
+        {
+            int chunk_first = atomic_fetch_add_explicit(&buffer->allocated, chunk_size, memory_order_relaxed);
+            if(chunk_first <= buffer->capacity - chunk_size)
+            {
+                commands->chunk_next = chunk_first;
+                commands->chunk_end = chunk_first + chunk_size;
+            }
+        }
+    }
+    
+    if(instance_count <= commands->chunk_end - commands->chunk_next)
+    {
+        result = commands->chunk_next;
+        commands->chunk_next += instance_count;
+    }
+    return result;
 }
 
-void SetVec3Uniform(GLuint program, char *name, float x, float y, float z)
+// NOTE(sokus): Reserves a command with room for its instances, the caller
+// writes them at instance_buffer->instances + first_instance. Returns 0 when
+// either buffer is full, the draw is dropped for this frame.
+RenderCommand *PushRenderCommand(RenderCommands *commands, uint64_t key,
+                                 Program *program, GLuint vao,
+                                 int vertex_count, int instance_count)
 {
-    GLint uniform_location = glGetUniformLocation(program, name);
-    glUniform3f(uniform_location, x, y, z);
+    RenderCommand *result = 0;
+    int first_instance = -1;
+    if(commands->command_count < commands->command_capacity)
+        first_instance = AllocateInstances(commands, instance_count);
+    
+    if(first_instance >= 0)
+    {
+        int command_idx = commands->command_count++;
+        result = commands->commands + command_idx;
+        result->program = program->handle;
+        result->vao = vao;
+        result->vertex_count = vertex_count;
+        result->first_instance = first_instance;
+        result->instance_count = instance_count;
+        
+        RenderSortEntry *entry = commands->sort_entries + command_idx;
+        entry->key = key;
+        entry->command_idx = (uint32_t)command_idx;
+        entry->list_idx = 0;
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Render command buffer full!\n");
+    }
+    return result;
+}
+
+bool PushDrawInstance(RenderCommands *commands, uint64_t key,
+                      Program *program, GLuint vao, int vertex_count,
+                      mat4 *model, vec4 color)
+{
+    RenderCommand *command = PushRenderCommand(commands, key, program, vao, vertex_count, 1);
+    if(command)
+        WriteInstance(commands->instance_buffer->instances + command->first_instance,
+                      &commands->view, &commands->view_projection, model, color);
+    return (command != 0);
+}
+
+bool PushDrawInstances(RenderCommands *commands, uint64_t key,
+                       Program *program, GLuint vao, int vertex_count,
+                       TransformArrays *transforms, int first, int count, vec4 color)
+{
+    RenderCommand *command = PushRenderCommand(commands, key, program, vao, vertex_count, count);
+    if(command)
+        WriteInstances(commands->instance_buffer->instances + command->first_instance,
+                       &commands->view, &commands->view_projection, transforms, first, count, color);
+    return (command != 0);
+}
+
+// NOTE(sokus): LSD radix sort a byte at a time, stable so equal keys keep
+// the order they were pushed in. Passes where every key has the same byte
+// (the unused bits, or only a few distinct programs) are skipped. Returns
+// whichever of the two arrays ended up holding the result.
+RenderSortEntry *RadixSortRenderKeys(RenderSortEntry *entries, RenderSortEntry *scratch, int count)
+{
+    RenderSortEntry *source = entries;
+    RenderSortEntry *destination = scratch;
+    for(int shift = 0; count > 1 && shift < 64; shift += 8)
+    {
+        uint32_t offsets[256] = {0};
+        for(int entry_idx = 0; entry_idx < count; ++entry_idx)
+            ++offsets[(source[entry_idx].key >> shift) & 0xFF];
+        if(offsets[(source[0].key >> shift) & 0xFF] == (uint32_t)count)
+            continue;
+        
+        uint32_t offset = 0;
+        for(int digit = 0; digit < 256; ++digit)
+        {
+            uint32_t digit_count = offsets[digit];
+            offsets[digit] = offset;
+            offset += digit_count;
+        }
+        for(int entry_idx = 0; entry_idx < count; ++entry_idx)
+            destination[offsets[(source[entry_idx].key >> shift) & 0xFF]++] = source[entry_idx];
+        SWAP(source, destination, RenderSortEntry *);
+    }
+    return source;
 }
 
-void SetMat4Uniform(GLuint program, char *name, mat4 *matrix)
+// NOTE(sokus): The merged keys and the sort scratch live in a temporary
+// block of the given arena, so it can be the frame's scratch arena. Unmaps
+// the instance buffer before drawing from it.
+void ExecuteRenderCommands(RenderCommands *lists, int list_count, MemoryArena *arena,
+                           InstanceBuffer *instance_buffer, RenderStats *stats)
 {
-    GLint uniform_location = glGetUniformLocation(program, name);
-    glUniformMatrix4fv(uniform_location, 1, GL_FALSE, &matrix->elements[0][0]);
-}
\ No newline at end of file
+    int command_count = 0;
+    for(int list_idx = 0; list_idx < list_count; ++list_idx)
+        command_count += lists[list_idx].command_count;
+    if(!UnmapInstanceBuffer(instance_buffer))
+        command_count = 0;
+    
+    TemporaryMemory sort_memory = BeginTemporaryMemory(arena);
+    RenderSortEntry *entries = PUSH_ARRAY(arena, RenderSortEntry, (size_t)MAX(command_count, 1));
+    RenderSortEntry *scratch = PUSH_ARRAY(arena, RenderSortEntry, (size_t)MAX(command_count, 1));
+    RenderSortEntry *entry = entries;
+    for(int list_idx = 0; command_count && list_idx < list_count; ++list_idx)
+    {
+        RenderCommands *list = lists + list_idx;
+        MEMORY_COPY(entry, list->sort_entries, (size_t)list->command_count * sizeof(RenderSortEntry));
+        for(int command_idx = 0; command_idx < list->command_count; ++command_idx)
+            entry[command_idx].list_idx = (uint32_t)list_idx;
+        entry += list->command_count;
+    }
+    RenderSortEntry *sorted = RadixSortRenderKeys(entries, scratch, command_count);
+    
+    // NOTE(sokus): Whatever ran before us (texture uploads, setup) may have
+    // left anything bound, so the first command binds everything.
+    GLuint bound_program = RENDER_STATE_UNKNOWN;
+    GLuint bound_vao = RENDER_STATE_UNKNOWN;
+    int draw_vertex_count = 0;
+    int draw_first_instance = 0;
+    int draw_instance_count = 0;
+    
+    for(int sorted_idx = 0; sorted_idx < command_count; ++sorted_idx)
+    {
+        RenderCommands *list = lists + sorted[sorted_idx].list_idx;
+        RenderCommand *command = list->commands + sorted[sorted_idx].command_idx;
+        
+        // NOTE(sokus): Opaque draws are only sorted by depth to help early
+        // z, not worth a draw per command. A command whose instances sit
+        // right before the draw's gets merged in too, which is what draws
+        // recorded far to near and sorted near to far look like.
+        bool opaque = ((sorted[sorted_idx].key >> RENDER_KEY_PASS_SHIFT) == RenderPass_Opaque);
+        bool follows = (command->first_instance == draw_first_instance + draw_instance_count);
+        bool precedes = (opaque && command->first_instance + command->instance_count == draw_first_instance);
+        if(command->program != bound_program || command->vao != bound_vao ||
+           command->vertex_count != draw_vertex_count || !(follows || precedes))
+        {
+            if(DrawInstanceRange(draw_vertex_count, draw_first_instance, draw_instance_count))
+                ++stats->draw_calls;
+            
+            if(command->program != bound_program)
+            {
+                glUseProgram(command->program);
+                bound_program = command->program;
+                ++stats->program_binds;
+            }
+            if(command->vao != bound_vao)
+            {
+                glBindVertexArray(command->vao);
+                bound_vao = command->vao;
+                ++stats->vao_binds;
+            }
+            draw_vertex_count = command->vertex_count;
+            draw_first_instance = command->first_instance;
+            draw_instance_count = 0;
+        }
+        else if(precedes)
+        {
+            draw_first_instance = command->first_instance;
+        }
+        draw_instance_count += command->instance_count;
+    }
+    if(DrawInstanceRange(draw_vertex_count, draw_first_instance, draw_instance_count))
+        ++stats->draw_calls;
+    
+    EndTemporaryMemory(sort_memory);
+    stats->commands += (uint64_t)command_count;
+    ++stats->frames;
+}
+
+void DumpRenderStats(RenderStats *stats, FILE *stream)
+{
+    double frames = (double)MAX(stats->frames, 1);
+    fprintf(stream, "render: %llu frames, per frame: %.1f commands, %.1f draws, "
+            "%.1f program / %.1f vao binds\n",
+            (unsigned long long)stats->frames,
+            (double)stats->commands / frames, (double)stats->draw_calls / frames,
+            (double)stats->program_binds / frames, (double)stats->vao_binds / frames);
+}